@@ -6,28 +6,42 @@ const QString CmManager::State("State");
 const QString CmManager::OfflineMode("OfflineMode");
 const QString CmManager::SessionMode("SessionMode");
 
+CmManager *CmManager::sInstance = nullptr;
+
 CmManager* CmManager::instance(QObject *parent)
 {
-	static CmManager *instance = new CmManager(parent);
-	return instance;
+	if (!sInstance)
+		sInstance = new CmManager(parent);
+	return sInstance;
 }
 
+/*
+ * Nothing is waited for, the initial data of connman is requested asynchronously and
+ * ready() is emitted once it is complete. If connman doesn't answer in time, or fails,
+ * it is requested again later, with an increasing interval.
+ */
 CmManager::CmManager(QObject *parent) :
 	QObject(parent),
-	connected(false),
+	mConnectionState(Disconnected),
 	mManager("net.connman", "/", VeDbusConnection::getConnection()),
 	mWatcher("net.connman", VeDbusConnection::getConnection(),
 			 QDBusServiceWatcher::WatchForRegistration | QDBusServiceWatcher::WatchForUnregistration),
+	mRetryMs(minRetryMs),
 	mAgent(parent)
 {
 	registerConnmanDataTypes();
 
+	mFetchTimer.setSingleShot(true);
+	mFetchTimer.setInterval(fetchTimeoutMs);
+	QObject::connect(&mFetchTimer, SIGNAL(timeout()), SLOT(fetchTimeout()));
+	mRetryTimer.setSingleShot(true);
+	QObject::connect(&mRetryTimer, SIGNAL(timeout()), SLOT(fetch()));
+
 	QObject::connect(&mWatcher, SIGNAL(serviceRegistered(QString)),SLOT(connmanRegistered(QString)));
 	QObject::connect(&mWatcher, SIGNAL(serviceUnregistered(QString)), SLOT(connmanUnregistered(QString)));
 
 	if (mManager.isValid()) {
-		if (getProperties())
-			connect();
+		fetch();
 	} else {
 		QDBusError err = mManager.lastError ();
 		qCritical() << "Connman connect error: " << err.message();
@@ -36,42 +50,151 @@ CmManager::CmManager(QObject *parent) :
 
 CmManager::~CmManager()
 {
+	if (sInstance == this)
+		sInstance = nullptr;
+	abort();
 	foreach (const CmTechnology *tech, mTechnologies)
 		delete tech;
 	foreach (const CmService *service, mServices)
 		delete service;
 }
 
-void CmManager::connect()
+void CmManager::setConnectionState(ConnectionState state)
+{
+	if (mConnectionState == state)
+		return;
+
+	mConnectionState = state;
+	emit connectionStateChanged();
+}
+
+void CmManager::fetch()
+{
+	if (mConnectionState != Disconnected)
+		return;
+
+	setConnectionState(Fetching);
+	mFetchTimer.start();
+	mPending << watch(mManager.GetProperties(), SLOT(propertiesReply(QDBusPendingCallWatcher*)));
+	mPending << watch(mManager.GetTechnologies(), SLOT(technologiesReply(QDBusPendingCallWatcher*)));
+	mPending << watch(mManager.GetServices(), SLOT(servicesReply(QDBusPendingCallWatcher*)));
+}
+
+QDBusPendingCallWatcher *CmManager::watch(QDBusPendingCall const &call, char const *slot)
+{
+	QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(call, this);
+	QObject::connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), slot);
+	return watcher;
+}
+
+// One of the initial requests is done, when all of them are, the data is complete.
+void CmManager::fetched(QDBusPendingCallWatcher *call)
+{
+	mPending.removeOne(call);
+	call->deleteLater();
+	if (!mPending.isEmpty())
+		return;
+
+	mFetchTimer.stop();
+	mRetryMs = minRetryMs;
+	setConnectionState(Ready);
+	emit ready();
+}
+
+// Drops the requests in progress, their replies are ignored.
+void CmManager::abort()
+{
+	foreach (QDBusPendingCallWatcher *watcher, mPending) {
+		QObject::disconnect(watcher, 0, this, 0);
+		watcher->deleteLater();
+	}
+	mPending.clear();
+	mFetchTimer.stop();
+}
+
+void CmManager::failed()
+{
+	abort();
+	disconnect();
+
+	qCritical() << "Connman: retrying in" << mRetryMs << "ms";
+	mRetryTimer.start(mRetryMs);
+	mRetryMs = qMin(mRetryMs * 2, maxRetryMs);
+}
+
+void CmManager::fetchTimeout()
+{
+	qCritical() << "Connman: no reply within" << fetchTimeoutMs << "ms";
+	failed();
+}
+
+void CmManager::propertiesReply(QDBusPendingCallWatcher *call)
 {
-	connected = true;
+	QDBusPendingReply<QVariantMap> reply = *call;
+	if (reply.isError()) {
+		qCritical() << "Connman GetProperties:" << reply.error().message();
+		failed();
+		return;
+	}
 
+	mProperties = reply.value();
 	QObject::connect(&mManager, SIGNAL(PropertyChanged(QString,QDBusVariant)),
-					 SLOT(propertyChanged(QString,QDBusVariant)));
+					 SLOT(propertyChanged(QString,QDBusVariant)), Qt::UniqueConnection);
+	emit stateChanged();
+	fetched(call);
+}
+
+void CmManager::technologiesReply(QDBusPendingCallWatcher *call)
+{
+	QDBusPendingReply<ConnmanObjectList> reply = *call;
+	if (reply.isError()) {
+		qCritical() << "Connman GetTechnologies:" << reply.error().message();
+		failed();
+		return;
+	}
 
-	if (getTechnologies())
-		connectTechnologies();
-	if (getServices())
-		connectServices();
+	const ConnmanObjectList list = reply.value();
+	foreach (const ConnmanObject &object, list)
+		addTechnology(object.path.path(), object.properties);
+	connectTechnologies();
+	fetched(call);
+}
+
+void CmManager::servicesReply(QDBusPendingCallWatcher *call)
+{
+	QDBusPendingReply<ConnmanObjectList> reply = *call;
+	if (reply.isError()) {
+		qCritical() << "Connman GetServices:" << reply.error().message();
+		failed();
+		return;
+	}
+
+	const ConnmanObjectList list = reply.value();
+	foreach (const ConnmanObject &object, list)
+		addService(object.path.path(), object.properties);
+	connectServices();
+	emit serviceListChanged();
+	fetched(call);
 }
 
 void CmManager::connectTechnologies()
 {
 	QObject::connect(&mManager, SIGNAL(TechnologyAdded(QDBusObjectPath,QVariantMap)),
-					 SLOT(technologyAdded(QDBusObjectPath,QVariantMap)));
+					 SLOT(technologyAdded(QDBusObjectPath,QVariantMap)), Qt::UniqueConnection);
 	QObject::connect(&mManager, SIGNAL(TechnologyRemoved(QDBusObjectPath)),
-					 SLOT(technologyRemoved(QDBusObjectPath)));
+					 SLOT(technologyRemoved(QDBusObjectPath)), Qt::UniqueConnection);
 }
 
 void CmManager::connectServices()
 {
 	QObject::connect(&mManager, SIGNAL(ServicesChanged(ConnmanObjectList,QList<QDBusObjectPath>)),
-					 SLOT(servicesChanged(ConnmanObjectList,QList<QDBusObjectPath>)));
+					 SLOT(servicesChanged(ConnmanObjectList,QList<QDBusObjectPath>)), Qt::UniqueConnection);
 }
 
 void CmManager::disconnect()
 {
-	connected = false;
+	QObject::disconnect(&mManager, SIGNAL(PropertyChanged(QString,QDBusVariant)),
+						this, SLOT(propertyChanged(QString,QDBusVariant)));
 
 	foreach (CmTechnology *tech, mTechnologies) {
 		mTechnologies.remove(tech->path());
@@ -88,6 +211,8 @@ void CmManager::disconnect()
 	}
 	emit serviceListChanged();
 	disconnectServices();
+
+	setConnectionState(Disconnected);
 }
 
 void CmManager::disconnectTechnologies()
@@ -104,44 +229,6 @@ void CmManager::disconnectServices()
 						this, SLOT(servicesChanged(ConnmanObjectList,QList<QDBusObjectPath>)));
 }
 
-bool CmManager::getProperties()
-{
-	QDBusPendingReply<QVariantMap> reply = mManager.GetProperties();
-	reply.waitForFinished();
-	if (reply.isValid()) {
-		mProperties = reply.value();
-		emit stateChanged();
-		return true;
-	}
-	return false;
-}
-
-bool CmManager::getTechnologies()
-{
-	QDBusPendingReply<ConnmanObjectList> reply = mManager.GetTechnologies();
-	reply.waitForFinished();
-	if (reply.isValid()) {
-		const ConnmanObjectList list = reply.value();
-		foreach (const ConnmanObject &object, list)
-			addTechnology(object.path.path(), object.properties);
-		return true;
-	}
-	return false;
-}
-
-bool CmManager::getServices()
-{
-	QDBusPendingReply<ConnmanObjectList> reply = mManager.GetServices();
-	reply.waitForFinished();
-	if (reply.isValid()) {
-		const ConnmanObjectList list = reply.value();
-		foreach (const ConnmanObject &object, list)
-			addService(object.path.path(), object.properties);
-		return true;
-	}
-	return false;
-}
-
 void CmManager::addTechnology(const QString &path, const QVariantMap &properties)
 {
 	if (!mTechnologies.contains(path)) {
@@ -226,12 +313,22 @@ void CmManager::unRegisterAgent(const QString &path)
 void CmManager::connmanRegistered(const QString& serviceName)
 {
 	Q_UNUSED(serviceName);
-	connect();
+
+	// Start over, e.g. when connman was restarted while still fetching.
+	abort();
+	if (mConnectionState != Disconnected)
+		disconnect();
+	mRetryTimer.stop();
+	mRetryMs = minRetryMs;
+	fetch();
 }
 
 void CmManager::connmanUnregistered(const QString& serviceName)
 {
 	Q_UNUSED(serviceName);
+
+	abort();
+	mRetryTimer.stop();
 	disconnect();
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QObject>
+#include <QTimer>
 #include "cmmananger_interface.h"
 #include "cmtechnology.h"
 #include "cmservice.h"
@@ -14,8 +15,19 @@ class CmManager : public QObject
 	Q_PROPERTY(QStringList serviceList READ getServiceList NOTIFY serviceListChanged)
 
 public:
+	// Disconnected until connman is on the bus, Fetching while the properties, technologies
+	// and services are requested, Ready once all of them are obtained.
+	enum ConnectionState {
+		Disconnected,
+		Fetching,
+		Ready
+	};
+
 	static CmManager* instance(QObject *parent = 0);
 
+	ConnectionState connectionState() const { return mConnectionState; }
+	bool isReady() const { return mConnectionState == Ready; }
+
 	Q_INVOKABLE CmTechnology* getTechnology(const QString &type) const;
 	Q_INVOKABLE QStringList getServiceList(const QString &type) const;
 	Q_INVOKABLE CmService* getService(const QString &path) const;
@@ -37,8 +49,15 @@ private slots:
 	void technologyRemoved(const QDBusObjectPath &objectPath);
 	void servicesChanged(const ConnmanObjectList &changed, const QList<QDBusObjectPath> &removed);
 	void dbusReply(QDBusPendingCallWatcher *call);
+	void propertiesReply(QDBusPendingCallWatcher *call);
+	void technologiesReply(QDBusPendingCallWatcher *call);
+	void servicesReply(QDBusPendingCallWatcher *call);
+	void fetch();
+	void fetchTimeout();
 
 signals:
+	void connectionStateChanged();
+	void ready();
 	void stateChanged();
 	void technologyListChanged();
 	void serviceListChanged();
@@ -51,23 +70,34 @@ private:
 	~CmManager();
 	void addTechnology(const QString &path, const QVariantMap &properties);
 	void addService(const QString &objectPath, const QVariantMap &properties);
-	void connect();
 	void connectTechnologies();
 	void connectServices();
 	void disconnect();
 	void disconnectTechnologies();
 	void disconnectServices();
-	bool getProperties();
-	bool getTechnologies();
-	bool getServices();
+	void setConnectionState(ConnectionState state);
+	QDBusPendingCallWatcher *watch(QDBusPendingCall const &call, char const *slot);
+	void fetched(QDBusPendingCallWatcher *call);
+	void abort();
+	void failed();
 
 	static const QString State;
 	static const QString OfflineMode;
 	static const QString SessionMode;
 
-	bool connected;
+	static const int fetchTimeoutMs = 10000;
+	static const int minRetryMs = 1000;
+	static const int maxRetryMs = 60000;
+
+	static CmManager *sInstance;
+
+	ConnectionState mConnectionState;
 	CmManangerInterface mManager;
 	QDBusServiceWatcher mWatcher;
+	QList<QDBusPendingCallWatcher *> mPending;
+	QTimer mFetchTimer;
+	QTimer mRetryTimer;
+	int mRetryMs;
 
 	CmAgent mAgent;
 	QVariantMap mProperties;
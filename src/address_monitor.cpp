@@ -0,0 +1,297 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <QDebug>
+#include <QSocketNotifier>
+
+#include "address_monitor.hpp"
+#include "item_id.hpp"
+
+AddressMonitor::AddressMonitor(VeQItem *parentItem, QObject *parent) :
+	QObject(parent)
+{
+	mItem = parentItem->itemGetOrCreate("Interfaces");
+	mRetryTimer.setSingleShot(true);
+	connect(&mRetryTimer, SIGNAL(timeout()), SLOT(refresh()));
+
+	mFd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+	if (mFd < 0) {
+		qCritical() << "[AddressMonitor] unable to open a netlink socket" << strerror(errno);
+		return;
+	}
+
+	struct sockaddr_nl addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR;
+
+	if (bind(mFd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0) {
+		qCritical() << "[AddressMonitor] unable to bind the netlink socket" << strerror(errno);
+		close(mFd);
+		mFd = -1;
+		return;
+	}
+
+	mNotifier = new QSocketNotifier(mFd, QSocketNotifier::Read, this);
+	connect(mNotifier, SIGNAL(activated(int)), SLOT(onReadable()));
+
+	dump();
+}
+
+AddressMonitor::~AddressMonitor()
+{
+	if (mFd >= 0)
+		close(mFd);
+}
+
+bool AddressMonitor::request(int type)
+{
+	struct {
+		struct nlmsghdr header;
+		struct rtgenmsg gen;
+	} req;
+
+	memset(&req, 0, sizeof(req));
+	req.header.nlmsg_len = NLMSG_LENGTH(sizeof(req.gen));
+	req.header.nlmsg_type = type;
+	req.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	req.header.nlmsg_seq = ++mSeq;
+	req.gen.rtgen_family = type == RTM_GETADDR ? AF_INET : AF_UNSPEC;
+
+	if (send(mFd, &req, req.header.nlmsg_len, 0) < 0) {
+		qCritical() << "[AddressMonitor] netlink request failed" << strerror(errno);
+		return false;
+	}
+
+	return true;
+}
+
+void AddressMonitor::onReadable()
+{
+	char buf[16384] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+	for (;;) {
+		ssize_t len = recv(mFd, buf, sizeof(buf), 0);
+		if (len < 0) {
+			// The kernel dropped notifications, the table is no longer reliable.
+			if (errno == ENOBUFS && !mDumpingLinks && !mDumpingAddresses && !mRetryTimer.isActive()) {
+				qWarning() << "[AddressMonitor] netlink overrun, refreshing";
+				refresh();
+			}
+			if (errno == EINTR || errno == ENOBUFS)
+				continue;
+			return;
+		}
+
+		nlmsghdr const *msg = reinterpret_cast<nlmsghdr const *>(buf);
+		for (; NLMSG_OK(msg, len); msg = NLMSG_NEXT(msg, len))
+			handleMessage(msg);
+	}
+}
+
+void AddressMonitor::handleMessage(nlmsghdr const *msg)
+{
+	switch (msg->nlmsg_type) {
+	case NLMSG_DONE:
+		if (mDumpingLinks) {
+			mDumpingLinks = false;
+			mDumpingAddresses = request(RTM_GETADDR);
+			if (!mDumpingAddresses)
+				dumpFailed();
+		} else if (mDumpingAddresses) {
+			mDumpingAddresses = false;
+			refreshed();
+		}
+		break;
+	case NLMSG_ERROR:
+		qWarning() << "[AddressMonitor] netlink error";
+		if (mDumpingLinks || mDumpingAddresses) {
+			mDumpingLinks = false;
+			mDumpingAddresses = false;
+			dumpFailed();
+		}
+		break;
+	case RTM_NEWLINK:
+	case RTM_DELLINK:
+		handleLink(msg);
+		break;
+	case RTM_NEWADDR:
+	case RTM_DELADDR:
+		handleAddress(msg);
+		break;
+	}
+}
+
+// Only a single dump can be active at a time, the addresses are requested when the
+// links are done.
+void AddressMonitor::dump()
+{
+	mDumpingLinks = request(RTM_GETLINK);
+	if (!mDumpingLinks)
+		dumpFailed();
+}
+
+// A partial dump is not reliable, the table before the refresh is restored, including
+// the addresses published in the meantime, and it is refreshed again later.
+void AddressMonitor::dumpFailed()
+{
+	if (mRefreshing) {
+		QHash<int, Interface> const partial = mInterfaces;
+		mInterfaces = mStale;
+		mStale.clear();
+		mRefreshing = false;
+		for (QHash<int, Interface>::const_iterator it = mInterfaces.constBegin(); it != mInterfaces.constEnd(); ++it) {
+			if (partial.value(it.key()).addresses != it->addresses)
+				changed(it.value());
+		}
+	}
+
+	qWarning() << "[AddressMonitor] dumping failed, retrying in" << mRetryMs << "ms";
+	mRetryTimer.start(mRetryMs);
+	mRetryMs = qMin(mRetryMs * 2, maxRetryMs);
+}
+
+// After an overrun or a failed dump the addresses are dumped again, the ones which were
+// removed in the meantime are only noticed by comparing with the table before it.
+void AddressMonitor::refresh()
+{
+	if (!mRefreshing) {
+		mStale = mInterfaces;
+		mRefreshing = true;
+	}
+	for (Interface &interface: mInterfaces)
+		interface.addresses.clear();
+	dump();
+}
+
+void AddressMonitor::refreshed()
+{
+	for (QHash<int, Interface>::const_iterator it = mStale.constBegin(); it != mStale.constEnd(); ++it) {
+		Interface const current = mInterfaces.value(it.key());
+		if (current.addresses != it->addresses)
+			changed(current.name.isEmpty() ? Interface{it->name, QList<Address>()} : current);
+	}
+	mStale.clear();
+	mRefreshing = false;
+	mRetryMs = minRetryMs;
+}
+
+void AddressMonitor::handleLink(nlmsghdr const *msg)
+{
+	struct ifinfomsg const *info = static_cast<struct ifinfomsg const *>(NLMSG_DATA(msg));
+	int index = info->ifi_index;
+
+	if (msg->nlmsg_type == RTM_DELLINK) {
+		QHash<int, Interface>::iterator it = mInterfaces.find(index);
+		if (it == mInterfaces.end())
+			return;
+		Interface interface = it.value();
+		mInterfaces.erase(it);
+		interface.addresses.clear();
+		changed(interface);
+		return;
+	}
+
+	QString name;
+	int len = IFLA_PAYLOAD(msg);
+	for (struct rtattr const *rta = IFLA_RTA(info); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+		if (rta->rta_type == IFLA_IFNAME)
+			name = QString::fromLocal8Bit(static_cast<char const *>(RTA_DATA(rta)));
+	}
+
+	Interface &interface = mInterfaces[index];
+	if (interface.name == name || name.isEmpty())
+		return;
+
+	// A renamed interface, e.g. by udev, publish the addresses under the new name.
+	if (!interface.name.isEmpty()) {
+		Interface old = interface;
+		old.addresses.clear();
+		changed(old);
+	}
+
+	interface.name = name;
+	changed(interface);
+}
+
+void AddressMonitor::handleAddress(nlmsghdr const *msg)
+{
+	struct ifaddrmsg const *ifa = static_cast<struct ifaddrmsg const *>(NLMSG_DATA(msg));
+	if (ifa->ifa_family != AF_INET)
+		return;
+
+	Address address;
+	address.prefixLength = ifa->ifa_prefixlen;
+	address.scope = ifa->ifa_scope;
+
+	// IFA_LOCAL is the address of the interface itself, IFA_ADDRESS the peer on ptp links.
+	int len = IFA_PAYLOAD(msg);
+	for (struct rtattr const *rta = IFA_RTA(ifa); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+		if (rta->rta_type != IFA_LOCAL && !(rta->rta_type == IFA_ADDRESS && address.address.isEmpty()))
+			continue;
+		char str[INET_ADDRSTRLEN];
+		if (inet_ntop(AF_INET, RTA_DATA(rta), str, sizeof(str)))
+			address.address = str;
+	}
+
+	if (address.address.isEmpty())
+		return;
+
+	Interface &interface = mInterfaces[ifa->ifa_index];
+	if (interface.name.isEmpty()) {
+		char name[IF_NAMESIZE];
+		if (if_indextoname(ifa->ifa_index, name))
+			interface.name = QString::fromLocal8Bit(name);
+	}
+
+	int pos = interface.addresses.indexOf(address);
+	if (msg->nlmsg_type == RTM_NEWADDR) {
+		if (pos >= 0)
+			return;
+		interface.addresses.append(address);
+	} else {
+		if (pos < 0)
+			return;
+		interface.addresses.removeAt(pos);
+	}
+
+	changed(interface);
+}
+
+void AddressMonitor::changed(Interface const &interface)
+{
+	if (interface.name.isEmpty())
+		return;
+
+	QStringList list;
+	for (Address const &address: interface.addresses)
+		list.append(address.address + "/" + QString::number(address.prefixLength));
+	mItem->itemGetOrCreateAndProduce(itemId(interface.name) + "/Addresses", list.join(","));
+
+	emit addressesChanged(interface.name);
+}
+
+QList<AddressMonitor::Address> AddressMonitor::addresses(QString const &interface) const
+{
+	for (Interface const &entry: mInterfaces) {
+		if (entry.name == interface)
+			return entry.addresses;
+	}
+	return QList<Address>();
+}
+
+// Like ip -o -4 addr show dev <interface> scope link, the first one.
+QString AddressMonitor::linkLocalAddress(QString const &interface) const
+{
+	for (Address const &address: addresses(interface)) {
+		if (address.scope == RT_SCOPE_LINK)
+			return address.address;
+	}
+	return QString();
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+
+#include <veutil/qt/ve_qitem.hpp>
+
+class QSocketNotifier;
+struct nlmsghdr;
+
+// Keeps the IPv4 addresses of all network interfaces in memory. The table is filled
+// by dumping the links and addresses once over rtnetlink and is kept up to date by
+// the RTM_NEWLINK, RTM_DELLINK, RTM_NEWADDR and RTM_DELADDR notifications, so no ip
+// command needs to run to find out an address.
+//
+// The addresses are exported as Interfaces/<name>/Addresses, e.g. 169.254.3.2/16.
+class AddressMonitor : public QObject
+{
+	Q_OBJECT
+
+public:
+	struct Address {
+		QString address;
+		int prefixLength;
+		int scope;
+
+		bool operator==(Address const &other) const {
+			return address == other.address && prefixLength == other.prefixLength && scope == other.scope;
+		}
+	};
+
+	AddressMonitor(VeQItem *parentItem, QObject *parent = 0);
+	~AddressMonitor();
+
+	QList<Address> addresses(QString const &interface) const;
+	QString linkLocalAddress(QString const &interface) const;
+
+signals:
+	void addressesChanged(QString const &interface);
+
+private slots:
+	void onReadable();
+	void refresh();
+
+private:
+	struct Interface {
+		QString name;
+		QList<Address> addresses;
+	};
+
+	bool request(int type);
+	void dump();
+	void dumpFailed();
+	void refreshed();
+	void handleMessage(nlmsghdr const *msg);
+	void handleLink(nlmsghdr const *msg);
+	void handleAddress(nlmsghdr const *msg);
+	void changed(Interface const &interface);
+
+	static int const minRetryMs = 1000;
+	static int const maxRetryMs = 60000;
+
+	int mFd = -1;
+	quint32 mSeq = 0;
+	bool mDumpingLinks = false;
+	bool mDumpingAddresses = false;
+	QSocketNotifier *mNotifier = nullptr;
+	QHash<int, Interface> mInterfaces;
+	QHash<int, Interface> mStale;
+	bool mRefreshing = false; // mStale is the table before the refresh
+	QTimer mRetryTimer;
+	int mRetryMs = minRetryMs;
+	VeQItem *mItem;
+};
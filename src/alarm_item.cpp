@@ -1,219 +1,321 @@
+#include <time.h>
+
+#include <QTimer>
+
 #include "alarm_item.hpp"
+#include "alarm_stats.hpp"
+#include "startup_timeline.hpp"
 
-/* ok, warning, alarm types */
-WarningAlarmMonitor *DeviceAlarms::addTripplet(const QString &description, const QString &busitemPathAlarm,
-						VeQItem *busitemSetting, const QString &busitemPathValue)
+DeviceAlarms::~DeviceAlarms()
 {
-	WarningAlarmMonitor *ret = new WarningAlarmMonitor(mService, AlarmMonitor::REGULAR, busitemPathAlarm,
-										 description, busitemSetting, busitemPathValue, this);
-	mAlarms.push_back(ret);
-	return ret;
-}
+	for (AlarmMonitor const &alarm: mAlarms) {
+		if (alarm.notification)
+			alarm.notification->setActive(false);
+	}
 
-void DeviceAlarms::addErrorFlag(const QString &description, const QString &busitemPathAlarm, VeQItem *busitemSetting)
-{
-	mAlarms.push_back(new AlarmMonitor(mService, AlarmMonitor::ERROR_FLAG, busitemPathAlarm, description, busitemSetting, "", this));
+	if (AlarmStats::instance()) {
+		AlarmStats::instance()->armed(-static_cast<int>(mAlarms.size() - mUnarmed));
+		AlarmStats::instance()->unarmed(-mUnarmed);
+	}
 }
 
-void DeviceAlarms::addVebusError(const QString &busitemPathAlarm)
-{
-	mAlarms.push_back(new AlarmMonitor(mService, AlarmMonitor::VEBUS_ERROR, busitemPathAlarm, "", nullptr, "", this));
-}
+/*
+ * Alarms are only armed once their trigger is present on the service, as reported by
+ * the GetItems / introspection snapshot or an ItemsChanged. Most services only support
+ * a part of the alarms in their table, e.g. the L2 / L3 alarms of a single phase Multi,
+ * so no items or D-Bus watches are created for the alarms which don't exist.
+ */
+void DeviceAlarms::addAlarms(AlarmTable const &table)
+{
+	size_t first = mAlarms.size();
+
+	mAlarms.reserve(first + table.count);
+	for (int n = 0; n < table.count; n++) {
+		AlarmMonitor alarm;
+
+		alarm.definition = &table.alarms[n];
+		alarm.context = table.context;
+		alarm.trigger = nullptr;
+		alarm.value = nullptr;
+		alarm.setting = nullptr;
+		alarm.notification = nullptr;
+		alarm.enabled = AlarmMonitor::NO_ALARM;
+		alarm.clearedAt = 0;
+		alarm.pendingSince = 0;
+		mAlarms.push_back(alarm);
+	}
 
-void DeviceAlarms::addBmsError(const QString &busitemPathAlarm)
-{
-	mAlarms.push_back(new AlarmMonitor(mService, AlarmMonitor::BMS_ERROR, busitemPathAlarm, "", nullptr, "", this));
-}
+	for (size_t n = first; n < mAlarms.size(); n++) {
+		VeQItem *trigger = presentItem(mAlarms[n].definition->path);
+		if (trigger) {
+			arm(mAlarms[n], trigger);
+		} else {
+			mUnarmed++;
+			if (AlarmStats::instance())
+				AlarmStats::instance()->unarmed();
+		}
+	}
 
-void DeviceAlarms::addChargerError(const QString &busitemPathAlarm)
-{
-	mAlarms.push_back(new AlarmMonitor(mService, AlarmMonitor::CHARGER_ERROR, busitemPathAlarm, "", nullptr, "", this));
+	reportArmed();
 }
 
-void DeviceAlarms::addAlternatorError(const QString &busitemPathAlarm)
+// The time to armed is that of the last alarm being armed. The alarms are created after
+// the snapshot of the service, so triggers which are not in its tree don't exist on the
+// service, e.g. the L2 / L3 alarms of a single phase Multi, and are not waited for. Only
+// the triggers which exist but are still being requested are.
+void DeviceAlarms::reportArmed()
 {
-	mAlarms.push_back(new AlarmMonitor(mService, AlarmMonitor::ALTERNATOR_ERROR, busitemPathAlarm, "", nullptr, "", this));
-}
+	if (mArmedReported || !AlarmStats::instance() || !mService->discoveredAt())
+		return;
 
-void DeviceAlarms::addGensetError(const QString &busitemPathAlarm)
-{
-	mAlarms.push_back(new AlarmMonitor(mService, AlarmMonitor::GENSET_ERROR, busitemPathAlarm, "", nullptr, "", this));
-}
+	for (AlarmMonitor const &alarm: mAlarms) {
+		if (alarm.trigger)
+			continue;
+		VeQItem *item = mService->item()->itemGet(QString::fromLatin1(alarm.definition->path).mid(1));
+		if (item && (item->getState() == VeQItem::Idle || item->getState() == VeQItem::Requested))
+			return;
+	}
 
-DeviceAlarms *DeviceAlarms::createBatteryAlarms(VenusService *service, Notifications *notications)
-{
-	return new BatteryAlarms(service, notications);
+	mArmedReported = true;
+	AlarmStats::instance()->serviceArmed(mService->getName(), StartupTimeline::now() - mService->discoveredAt());
 }
 
-DeviceAlarms *DeviceAlarms::createGeneratorStartStopAlarms(VenusService *service, Notifications *notications)
+// Returns the item if the service has it. Otherwise the deepest existing item is
+// watched, so the alarms can be armed once it shows up.
+VeQItem *DeviceAlarms::presentItem(char const *path)
 {
-	DeviceAlarms *alarms = new DeviceAlarms(service, notications);
+	VeQItem *item = mService->item();
+
+	for (QString const &id: QString::fromLatin1(path).split('/')) {
+		if (id.isEmpty())
+			continue;
+		VeQItem *child = item->itemGet(id);
+		if (!child) {
+			connect(item, SIGNAL(childAdded(VeQItem*)), this, SLOT(onPresenceChanged()), Qt::UniqueConnection);
+			return nullptr;
+		}
+		item = child;
+	}
 
-	alarms->addTripplet(tr("Generator not detected at AC input"), "/Alarms/NoGeneratorAtAcIn", nullptr, "");
-	alarms->addTripplet(tr("Service interval exceeded"), "/Alarms/ServiceIntervalExceeded", nullptr);
-	alarms->addTripplet(tr("GX Auto start/stop is disabled"), "/Alarms/AutoStartDisabled", nullptr);
-	alarms->addTripplet(tr("Remote start is disabled on the genset"), "/Alarms/RemoteStartModeDisabled", nullptr);
+	// The item might have been created locally, e.g. as a parent, without it being on the service.
+	if (item->getState() == VeQItem::Synchronized)
+		return item;
 
-	return alarms;
+	// Items only known from the introspection, e.g. when there is no GetItems snapshot, or
+	// from an ItemsChanged without a value, are requested. They are armed once obtained.
+	connect(item, SIGNAL(stateChanged(VeQItem::State)), this, SLOT(onPresenceChanged()), Qt::UniqueConnection);
+	if (item->getState() == VeQItem::Idle)
+		item->getValue();
+	return nullptr;
 }
 
-DeviceAlarms *DeviceAlarms::createDigitalInputAlarms(VenusService *service, Notifications *notications)
+// Items are added in bursts, e.g. for a complete distributor, check them once.
+void DeviceAlarms::onPresenceChanged()
 {
-	DeviceAlarms *alarms = new DeviceAlarms(service, notications);
-
-	alarms->addTripplet("", "/Alarm", nullptr, "");
+	if (mArmScheduled || mUnarmed == 0)
+		return;
 
-	return alarms;
+	mArmScheduled = true;
+	QTimer::singleShot(0, this, SLOT(armPresent()));
 }
 
-DeviceAlarms *DeviceAlarms::createSolarChargerAlarms(VenusService *service, Notifications *notications)
+void DeviceAlarms::armPresent()
 {
-	DeviceAlarms *alarms = new DeviceAlarms(service, notications);
+	mArmScheduled = false;
+
+	for (AlarmMonitor &alarm: mAlarms) {
+		if (alarm.trigger)
+			continue;
 
-	alarms->addTripplet(tr("Low battery voltage"),		"/Alarms/LowVoltage",	nullptr,	"");
-	alarms->addTripplet(tr("High battery voltage"),		"/Alarms/HighVoltage",	nullptr,	"");
-	alarms->addTripplet(tr("High temperature"),			"/Alarms/HighTemperature",	nullptr,	"");
-	alarms->addTripplet(tr("Short circuit"),			"/Alarms/ShortCircuit",		nullptr,	"");
-	alarms->addChargerError("/ErrorCode");
+		VeQItem *trigger = presentItem(alarm.definition->path);
+		if (trigger) {
+			arm(alarm, trigger);
+			mUnarmed--;
+			if (AlarmStats::instance())
+				AlarmStats::instance()->unarmed(-1);
+		}
+	}
 
-	return alarms;
+	reportArmed();
 }
 
-DeviceAlarms *DeviceAlarms::createAcChargerAlarms(VenusService *service, Notifications *notications)
+void DeviceAlarms::arm(AlarmMonitor &alarm, VeQItem *trigger)
 {
-	DeviceAlarms *alarms = new DeviceAlarms(service, notications);
+	AlarmDefinition const *definition = alarm.definition;
 
-	alarms->addTripplet(tr("Low battery voltage"),		"/Alarms/LowVoltage",	nullptr,	"");
-	alarms->addTripplet(tr("High battery voltage"),		"/Alarms/HighVoltage",	nullptr,	"");
-	alarms->addChargerError("/ErrorCode");
+	alarm.trigger = trigger;
+	alarm.enabled = AlarmMonitor::ALARM_AND_WARNING;
+	if (AlarmStats::instance())
+		AlarmStats::instance()->armed();
 
-	return alarms;
-}
+	// Optionally an value can be associated with an alarm, e.g. voltage
+	// for an low voltage alarm.
+	if (definition->valuePath) {
+		alarm.value = mService->item(definition->valuePath);
+		alarm.value->getText();
+	}
 
-DeviceAlarms *DeviceAlarms::createInverterAlarms(VenusService *service, Notifications *notications)
-{
-	DeviceAlarms *alarms = new DeviceAlarms(service, notications);
-
-	alarms->addTripplet(tr("Low battery voltage"),	"/Alarms/LowVoltage",		service->item("/Settings/AlarmLevel/LowVoltage"),		"");
-	alarms->addTripplet(tr("High battery voltage"),	"/Alarms/HighVoltage",		service->item("/Settings/AlarmLevel/HighVoltage"),		"");
-	alarms->addTripplet(tr("Low AC voltage"),		"/Alarms/LowVoltageAcOut",	service->item("/Settings/AlarmLevel/LowVoltageAcOut"),	"/Ac/Out/L1/V");
-	alarms->addTripplet(tr("High AC voltage"),		"/Alarms/HighVoltageAcOut",	service->item("/Settings/AlarmLevel/HighVoltageAcOut"),	"/Ac/Out/L1/V");
-	alarms->addTripplet(tr("Low temperature"),		"/Alarms/LowTemperature",	nullptr,												"");
-	alarms->addTripplet(tr("High temperature"),		"/Alarms/HighTemperature",	service->item("/Settings/AlarmLevel/HighTemperature"),	"");
-	alarms->addTripplet(tr("Inverter overload"),	"/Alarms/Overload",			service->item("/Settings/AlarmLevel/Overload"),			"/Ac/Out/L1/I");
-	alarms->addTripplet(tr("High DC ripple"),		"/Alarms/Ripple",			service->item("/Settings/AlarmLevel/Ripple"),			"");
-	alarms->addTripplet(tr("Low SOC"),				"/Alarms/LowSoc",			service->item("/Settings/AlarmLevel/LowSoc"),			"/Soc");
-
-	return alarms;
-}
+	// Alarms can optionally be enabled / supressed by a setting, but the setting is not necessarily present.
+	// The settings are shared by several alarms, so they are connected once.
+	if (definition->setting) {
+		if (definition->systemSetting)
+			alarm.setting = VeQItems::getRoot()->itemGetOrCreate("dbus/com.victronenergy.settings")->itemGetOrCreate(definition->setting);
+		else
+			alarm.setting = mService->item(definition->setting);
+
+		connect(alarm.setting, SIGNAL(stateChanged(VeQItem::State)), this, SLOT(onSettingStateChanged(VeQItem::State)), Qt::UniqueConnection);
+		connect(alarm.setting, SIGNAL(valueChanged(QVariant)), this, SLOT(onSettingChanged(QVariant)), Qt::UniqueConnection);
+
+		QVariant var = alarm.setting->getValue();
+		if (var.isValid())
+			alarm.enabled = static_cast<quint8>(var.toInt());
+		else if (alarm.setting->getState() != VeQItem::Offline)
+			alarm.enabled = AlarmMonitor::NO_ALARM;
+	}
 
-DeviceAlarms *DeviceAlarms::createMultiRsAlarms(VenusService *service, Notifications *notications)
-{
-	DeviceAlarms *alarms = new DeviceAlarms(service, notications);
-
-	alarms->addTripplet(tr("Low battery voltage"),	"/Alarms/LowVoltage",		service->item("/Settings/AlarmLevel/LowVoltage"),		"");
-	alarms->addTripplet(tr("High battery voltage"),	"/Alarms/HighVoltage",		service->item("/Settings/AlarmLevel/HighVoltage"),		"");
-	alarms->addTripplet(tr("Low AC voltage"),		"/Alarms/LowVoltageAcOut",	service->item("/Settings/AlarmLevel/LowVoltageAcOut"),	""); /* Single phase is not always on L1 */
-	alarms->addTripplet(tr("High AC voltage"),		"/Alarms/HighVoltageAcOut",	service->item("/Settings/AlarmLevel/HighVoltageAcOut"),	""); /* Single phase is not always on L1 */
-	alarms->addTripplet(tr("High temperature"),		"/Alarms/HighTemperature",	service->item("/Settings/AlarmLevel/HighTemperature"),	"");
-	alarms->addTripplet(tr("Inverter overload"),	"/Alarms/Overload",			service->item("/Settings/AlarmLevel/Overload"),			""); /* Single phase is not always on L1 */
-	alarms->addTripplet(tr("High DC ripple"),		"/Alarms/Ripple",			service->item("/Settings/AlarmLevel/Ripple"),			"");
-	alarms->addTripplet(tr("Low SOC"),				"/Alarms/LowSoc",			service->item("/Settings/AlarmLevel/LowSoc"),			"/Soc");
-	alarms->addTripplet(tr("Short circuit"),		"/Alarms/ShortCircuit",		service->item("/Settings/AlarmLevel/ShortCircuit"),		"");
-	alarms->addTripplet(tr("Grid lost"),			"/Alarms/GridLost",			service->item("/Settings/AlarmLevel/GridLost"),			"");
-	alarms->addTripplet(tr("Phase rotation"),		"/Alarms/PhaseRotation",	service->item("/Settings/AlarmLevel/PhaseRotation"),	"");
-	alarms->addChargerError("/ErrorCode");
-
-	return alarms;
+	// The actual trigger of the alarm, see AlarmMonitor::Type for the supported formats.
+	connect(trigger, SIGNAL(valueChanged(QVariant)), this, SLOT(onTriggerChanged(QVariant)), Qt::UniqueConnection);
+	updateAlarm(alarm, trigger->getValue());
 }
 
-DeviceAlarms *DeviceAlarms::createSystemCalcAlarms(VenusService *service, Notifications *notications)
+void DeviceAlarms::onTriggerChanged(QVariant var)
 {
-	DeviceAlarms *alarms = new DeviceAlarms(service, notications);
+	VeQItem *trigger = static_cast<VeQItem *>(sender());
 
-	alarms->addTripplet(tr("Circuit breaker tripped"), "/Dc/Battery/Alarms/CircuitBreakerTripped", nullptr, "");
-	alarms->addTripplet(tr("DVCC with incompatible firmware #48"), "/Dvcc/Alarms/FirmwareInsufficient", nullptr, "");
+	AlarmStats *stats = AlarmStats::instance();
 
-	return alarms;
-}
-
-DeviceAlarms *DeviceAlarms::createVecanAlarms(VenusService *service, Notifications *notications)
-{
-	DeviceAlarms *alarms = new DeviceAlarms(service, notications);
+	mTriggerTime = StartupTimeline::now();
+	if (stats) {
+		stats->triggered();
+		stats->setTriggerTime(mTriggerTime);
+	}
 
-	alarms->addTripplet("Please set the VE.Can number to a free one", "/Alarms/SameUniqueNameUsed", nullptr, "");
+	for (AlarmMonitor &alarm: mAlarms) {
+		if (alarm.trigger == trigger)
+			updateAlarm(alarm, var);
+	}
 
-	return alarms;
+	mTriggerTime = 0;
+	if (stats)
+		stats->setTriggerTime(0);
 }
 
-DeviceAlarms *DeviceAlarms::createEssAlarms(VenusService *service, Notifications *notications)
+// Copied to enabled since having the enabled as a setting is optional
+void DeviceAlarms::onSettingChanged(QVariant var)
 {
-	DeviceAlarms *alarms = new DeviceAlarms(service, notications);
-
-	alarms->addTripplet(tr("Grid meter not found #49"), "/Alarms/NoGridMeter", nullptr, "");
+	VeQItem *setting = static_cast<VeQItem *>(sender());
 
-	return alarms;
+	for (AlarmMonitor &alarm: mAlarms) {
+		if (alarm.setting != setting)
+			continue;
+		alarm.enabled = static_cast<quint8>(var.toInt());
+		updateAlarm(alarm, alarm.trigger->getValue());
+	}
 }
 
-DeviceAlarms *DeviceAlarms::createTankAlarms(VenusService *service, Notifications *notications)
+void DeviceAlarms::onSettingStateChanged(VeQItem::State state)
 {
-	DeviceAlarms *alarms = new DeviceAlarms(service, notications);
-
-	alarms->addTripplet(tr("Low level alarm"),  "/Alarms/Low/State",  nullptr, "/Level");
-	alarms->addTripplet(tr("High level alarm"), "/Alarms/High/State", nullptr, "/Level");
+	if (state != VeQItem::Offline)
+		return;
 
-	return alarms;
+	/* Setting not present, allow warnings and alarms */
+	VeQItem *setting = static_cast<VeQItem *>(sender());
+	for (AlarmMonitor &alarm: mAlarms) {
+		if (alarm.setting == setting)
+			alarm.enabled = AlarmMonitor::ALARM_AND_WARNING;
+	}
+	disconnect(setting, SIGNAL(stateChanged(VeQItem::State)), this, SLOT(onSettingStateChanged(VeQItem::State)));
 }
 
-DeviceAlarms *DeviceAlarms::createDcMeterAlarms(VenusService *service, Notifications *notications)
+void DeviceAlarms::onNotificationDestroyed(QObject *object)
 {
-	DeviceAlarms *alarms = new DeviceAlarms(service, notications);
-
-	alarms->addTripplet(tr("Low voltage"),		"/Alarms/LowVoltage",			nullptr,	"");
-	alarms->addTripplet(tr("High voltage"),		"/Alarms/HighVoltage",			nullptr,	"");
-	alarms->addTripplet(tr("Low aux voltage"),	"/Alarms/LowStarterVoltage",	nullptr,	"");
-	alarms->addTripplet(tr("High aux voltage"),	"/Alarms/HighStarterVoltage",	nullptr,	"");
-	alarms->addTripplet(tr("Low temperature"),	"/Alarms/LowTemperature",		nullptr,	"/Dc/0/Temperature");
-	alarms->addTripplet(tr("High Temperature"),	"/Alarms/HighTemperature",		nullptr,	"/Dc/0/Temperature");
-
-	return alarms;
+	for (AlarmMonitor &alarm: mAlarms) {
+		if (alarm.notification == object)
+			alarm.notification = nullptr;
+	}
 }
 
-DeviceAlarms *DeviceAlarms::createAlternatorAlarms(VenusService *service, Notifications *notications)
+/*
+ * An alarm which returns within the flap window, or changes between warning and alarm,
+ * reuses its notification and increments its RepeatCount. A new alarm is only notified
+ * when it is still present after the debounce time.
+ */
+void DeviceAlarms::updateAlarm(AlarmMonitor &alarm, QVariant const &var)
 {
-	DeviceAlarms *alarms = createDcMeterAlarms(service, notications);
+	qint64 now = StartupTimeline::now() / 1000;
+	QString description = alarm.description(singlePhase());
+	AlarmMonitor::DbusAlarm state = AlarmMonitor::DBUS_NO_ERROR;
 
-	alarms->addChargerError("/ErrorCode"); /* Victron: Orion XS */
-	alarms->addAlternatorError("/Error/0/Id"); /* Third party: Wakespeed, ARCO, etc */
+	if (var.isValid() && alarm.enabled != AlarmMonitor::NO_ALARM)
+		state = alarm.evaluate(var, nrOfPhases(), &description);
 
-	return alarms;
-}
+	if (!alarm.mustBeShown(state)) {
+		// If there was a previous warning / error it is no longer valid, but kept for a repeat
+		alarm.pendingSince = 0;
+		if (alarm.notification && alarm.notification->isActive()) {
+			alarm.notification->setActive(false);
+			alarm.clearedAt = now;
+		}
+		return;
+	}
 
-DeviceAlarms *DeviceAlarms::createDcdcAlarms(VenusService *service, Notifications *notications)
-{
-	DeviceAlarms *alarms = new DeviceAlarms(service, notications);
+	Notification::Type type = state == AlarmMonitor::DBUS_WARNING ? Notification::WARNING : Notification::ALARM;
+	QString value = alarm.value ? alarm.value->getText() : QString();
+
+	if (alarm.notification && (alarm.notification->isActive() ||
+							   now - alarm.clearedAt < mNotifications->flapWindow() * 1000LL)) {
+		mNotifications->repeatNotification(alarm.notification, type, value, description, var);
+		notified(false);
+		return;
+	}
 
-	alarms->addChargerError("/ErrorCode");
+	int debounce = mNotifications->debounce();
+	if (debounce > 0) {
+		if (!alarm.pendingSince)
+			alarm.pendingSince = now;
+		if (now - alarm.pendingSince < debounce) {
+			scheduleDebounce(static_cast<int>(alarm.pendingSince + debounce - now));
+			return;
+		}
+	}
 
-	return alarms;
+	alarm.pendingSince = 0;
+	if (alarm.notification)
+		alarm.notification->disconnect(this);
+	alarm.notification = mNotifications->addNotification(type, mService->getDescription(), value, description,
+														 alarm.definition->path, var, mService->getName());
+	connect(alarm.notification, SIGNAL(destroyed(QObject*)), this, SLOT(onNotificationDestroyed(QObject*)));
+	notified(true);
 }
 
-DeviceAlarms *DeviceAlarms::createPlatformAlarms(VenusService *service, Notifications *notications)
+// Only the latency of a trigger change is recorded, not of e.g. a debounced alarm.
+void DeviceAlarms::notified(bool added)
 {
-	DeviceAlarms *alarms = new DeviceAlarms(service, notications);
+	AlarmStats *stats = AlarmStats::instance();
+	if (!stats)
+		return;
 
-	alarms->addTripplet(tr("#42 Storage is corrupt on this device"), "/Device/DataPartitionError",  nullptr, "");
+	if (added)
+		stats->notificationAdded();
+	else
+		stats->notificationRepeated();
 
-	return alarms;
+	if (mTriggerTime)
+		stats->triggerToNotification(StartupTimeline::now() - mTriggerTime);
 }
 
-DeviceAlarms *DeviceAlarms::createTemperatureSensorAlarms(VenusService *service, Notifications *noticationCenter)
+void DeviceAlarms::scheduleDebounce(int ms)
 {
-	DeviceAlarms *alarms = new DeviceAlarms(service, noticationCenter);
-
-	alarms->addTripplet(tr("Low battery"), "/Alarms/LowBattery", nullptr, "/BatteryVoltage");
+	if (!mDebounceTimer.isActive() || mDebounceTimer.remainingTime() > ms)
+		mDebounceTimer.start(ms);
+}
 
-	return alarms;
+void DeviceAlarms::onDebounceTimeout()
+{
+	for (AlarmMonitor &alarm: mAlarms) {
+		if (alarm.pendingSince)
+			updateAlarm(alarm, alarm.trigger->getValue());
+	}
 }
 
 VebusAlarms::VebusAlarms(VenusService *service, Notifications *notications) :
@@ -225,70 +327,26 @@ VebusAlarms::VebusAlarms(VenusService *service, Notifications *notications) :
 	mConnectionType->getValueAndChanges(this, SLOT(connectionTypeChanged(QVariant)));
 }
 
-void VebusAlarms::init(bool single)
-{
-	VeQItem *settings = VeQItems::getRoot()->itemGetOrCreate("dbus/com.victronenergy.settings/Settings/Alarm");
-
-	addVebusError("/VebusError");
-	addTripplet(tr("Temperature sense error"),	"/Alarms/TemperatureSensor",	settings->itemGetOrCreate("/Vebus/TemperatureSenseError"));
-	addTripplet(tr("Voltage sense error"),		"/Alarms/VoltageSensor",		settings->itemGetOrCreate("/Vebus/VoltageSenseError"));
-	addTripplet(tr("Low battery voltage"),		"/Alarms/LowBattery",			settings->itemGetOrCreate("/Vebus/LowBattery"));
-	addTripplet(tr("High DC ripple"),			"/Alarms/Ripple",				settings->itemGetOrCreate("/Vebus/HighDcRipple"));
-	addTripplet(tr("Wrong phase rotation detected"), "/Alarms/PhaseRotation");
-
-	// Phase 1 (note the description depends on the number of phases!)
-	highTempTextL1Alarm = addTripplet(highTempTextL1(single),					"/Alarms/L1/HighTemperature",	settings->itemGetOrCreate("/Vebus/HighTemperature"));
-	inverterOverloadTextL1Alarm = addTripplet(inverterOverloadTextL1(single),	"/Alarms/L1/Overload",			settings->itemGetOrCreate("/Vebus/InverterOverload"));
-	// Phase 2
-	addTripplet(tr("High Temperature on L2"),	"/Alarms/L2/HighTemperature",	settings->itemGetOrCreate("/Vebus/HighTemperature"));
-	addTripplet(tr("Inverter overload on L2"),	"/Alarms/L2/Overload",			settings->itemGetOrCreate("/Vebus/InverterOverload"));
-	// Phase 3
-	addTripplet(tr("High Temperature on L3"),	"/Alarms/L3/HighTemperature",	settings->itemGetOrCreate("/Vebus/HighTemperature"));
-	addTripplet(tr("Inverter overload on L3"),	"/Alarms/L3/Overload",			settings->itemGetOrCreate("/Vebus/InverterOverload"));
-
-	// Grid alarm
-	addTripplet(tr("Grid lost"),				"/Alarms/GridLost");
-
-	// DC voltage and current alarms
-	addTripplet(tr("High DC voltage"),			"/Alarms/HighDcVoltage",		settings->itemGetOrCreate("/Vebus/HighDcVoltage"));
-	addTripplet(tr("High DC current"),			"/Alarms/HighDcCurrent",		settings->itemGetOrCreate("/Vebus/HighDcCurrent"));
-
-	// VE.Bus BMS related alarms
-	addTripplet(tr("BMS pre-alarm"),			"/Alarms/BmsPreAlarm");
-	addTripplet(tr("BMS connection lost"),		"/Alarms/BmsConnectionLost");
-
-	new mk3FirmwareUpdateNotification(this);
-}
-
-void VebusAlarms::update(bool single)
-{
-	// update phase 1 (note the description depends on the number of phases!)
-	highTempTextL1Alarm->setDescription(highTempTextL1(single));
-	inverterOverloadTextL1Alarm->setDescription(inverterOverloadTextL1(single));
-}
-
 void VebusAlarms::connectionTypeChanged(QVariant var)
 {
-	VeQItem *settings = VeQItems::getRoot()->itemGetOrCreate("dbus/com.victronenergy.settings/Settings/Alarm");
-
 	if (var.isValid() && var.value<QString>() == "VE.Can") {
-		// backwards compatible, the CAN-bus sends these e.g.
-		addTripplet(tr("High Temperature"),			"/Alarms/HighTemperature",		settings->itemGetOrCreate("/Vebus/HighTemperature"));
-		addTripplet(tr("Inverter overload"),		"/Alarms/Overload",				settings->itemGetOrCreate("/Vebus/InverterOverload"));
+		addAlarms(AlarmTables::vebusCan);
 		mConnectionType->disconnect(this, SLOT(connectionTypeChanged(QVariant)));
 	}
 }
 
+// Note: the description of the L1 alarms depends on the number of phases, it is
+// determined when the notification is added.
 void VebusAlarms::numberOfPhasesChanged(QVariant var)
 {
 	if (!var.isValid())
 		return;
 
-	bool singlePhase = var.toInt() == 1;
-	if (mAlarms.empty()) {
-		init(singlePhase);
-	} else {
-		update(singlePhase);
+	mSinglePhase = var.toInt() == 1;
+	if (!mInitialized) {
+		mInitialized = true;
+		addAlarms(AlarmTables::vebus);
+		new mk3FirmwareUpdateNotification(this);
 	}
 }
 
@@ -298,36 +356,7 @@ BatteryAlarms::BatteryAlarms(VenusService *service, Notifications *notications)
 	mNrOfDistributors = service->item("/NrOfDistributors");
 	mNrOfDistributors->getValueAndChanges(this, SLOT(numberOfDistributorsChanged(QVariant)));
 
-	addTripplet(tr("Low voltage"),						"/Alarms/LowVoltage",							nullptr,		"");
-	addTripplet(tr("High voltage"),						"/Alarms/HighVoltage",							nullptr,		"");
-	addTripplet(tr("High cell voltage"),				"/Alarms/HighCellVoltage",						nullptr,		"");
-	addTripplet(tr("High current"),						"/Alarms/HighCurrent",							nullptr,		"");
-	addTripplet(tr("High charge current"),				"/Alarms/HighChargeCurrent",					nullptr,		"");
-	addTripplet(tr("High discharge current"),			"/Alarms/HighDischargeCurrent",					nullptr,		"");
-	addTripplet(tr("High charge temperature"),			"/Alarms/HighChargeTemperature",				nullptr,		"/Dc/0/Temperature");
-	addTripplet(tr("Low charge temperature"),			"/Alarms/LowChargeTemperature",					nullptr,		"/Dc/0/Temperature");
-	addTripplet(tr("Low SOC"),							"/Alarms/LowSoc",								nullptr,		"/Soc");
-	addTripplet(tr("State of health"),					"/Alarms/StateOfHealth",						nullptr,		"/Soh");
-	addTripplet(tr("Low starter voltage"),				"/Alarms/LowStarterVoltage",					nullptr,		"");
-	addTripplet(tr("High starter voltage"),				"/Alarms/HighStarterVoltage",					nullptr,		"");
-	addTripplet(tr("Low temperature"),					"/Alarms/LowTemperature",						nullptr,		"/Dc/0/Temperature");
-	addTripplet(tr("High Temperature"),					"/Alarms/HighTemperature",						nullptr,		"/Dc/0/Temperature");
-	addTripplet(tr("Mid-point voltage"),				"/Alarms/MidVoltage",							nullptr,		"");
-	addTripplet(tr("Low-fused voltage"),				"/Alarms/LowFusedVoltage",						nullptr,		"");
-	addTripplet(tr("High-fused voltage"),				"/Alarms/HighFusedVoltage",						nullptr,		"");
-	addTripplet(tr("Fuse blown"),						"/Alarms/FuseBlown",							nullptr,		"");
-	addTripplet(tr("High internal temperature"),		"/Alarms/HighInternalTemperature",				nullptr,		"");
-	addTripplet(tr("Internal failure"),					"/Alarms/InternalFailure",						nullptr,		"");
-	addTripplet(tr("Battery temperature sensor"),		"/Alarms/BatteryTemperatureSensor",				nullptr,"");
-	addTripplet(tr("Cell imbalance"),					"/Alarms/CellImbalance",						nullptr,		"");
-	addTripplet(tr("Low cell voltage"),					"/Alarms/LowCellVoltage",						nullptr,		"/System/MinCellVoltage");
-	addTripplet(tr("Bad contactor"),					"/Alarms/Contactor",							nullptr,		"");
-	addTripplet(tr("BMS cable fault"),					"/Alarms/BmsCable",								nullptr,		"");
-	addErrorFlag(tr("Communication error"),				"/Errors/SmartLithium/Communication",			nullptr);
-	addErrorFlag(tr("Invalid battery configuration"),	"/Errors/SmartLithium/InvalidConfiguration",	nullptr);
-	addErrorFlag(tr("Incorrect number of batteries"),	"/Errors/SmartLithium/NrOfBatteries",			nullptr);
-	addErrorFlag(tr("Battery voltage not supported"),	"/Errors/SmartLithium/Voltage",					nullptr);
-	addBmsError("/ErrorCode");
+	addAlarms(AlarmTables::battery);
 }
 
 void BatteryAlarms::numberOfDistributorsChanged(QVariant var)
@@ -335,18 +364,7 @@ void BatteryAlarms::numberOfDistributorsChanged(QVariant var)
 	if (!var.isValid() || var.toInt() <= 0 || mDistributorAlarmsAdded)
 		return;
 
-	/* Register alarms for all distributors and fuses as /NrOfDistributors reflects the number of connected
-	 * distributors, not which distributors are connected. I.e. distributor C & D can be present without A & B being present. */
-	for (int d = 0; d < 8; d++) {
-		const char distName = 'A' + d;
-		const QString distPath = QString("/Distributor/%1").arg(distName);
-		addTripplet(tr("Distributor %1 connection lost").arg(distName), distPath + "/Alarms/ConnectionLost", nullptr, "");
-		for (int f = 0; f < 8; f++) {
-			const QString fusePath = (distPath + "/Fuse/%1").arg(f);
-			addTripplet(tr("Fuse blown"), fusePath + "/Alarms/Blown", nullptr, fusePath + "/Name");
-		}
-	}
-
+	addAlarms(AlarmTables::distributors());
 	mDistributorAlarmsAdded = true;
 }
 
@@ -356,7 +374,7 @@ GensetAlarms::GensetAlarms(VenusService *service, Notifications *notications) :
 	mNumberOfPhasesItem = service->item("/NrOfPhases");
 	mNumberOfPhasesItem->getValueAndChanges(this, SLOT(numberOfPhasesChanged(QVariant)));
 
-	addGensetError("/Error/0/Id");
+	addAlarms(AlarmTables::genset);
 }
 
 void GensetAlarms::numberOfPhasesChanged(QVariant var)
@@ -379,64 +397,22 @@ void AlarmBusitems::onVenusServiceFound(VenusService *service)
 	switch (service->getType())
 	{
 	case VenusServiceType::BATTERY:
-		DeviceAlarms::createBatteryAlarms(service, mNotifications);
-		break;
-	case VenusServiceType::FUEL_CELL:
-	case VenusServiceType::DC_SOURCE:
-	case VenusServiceType::DC_LOAD:
-	case VenusServiceType::DC_SYSTEM:
-		DeviceAlarms::createDcMeterAlarms(service, mNotifications);
-		break;
-	case VenusServiceType::ALTERNATOR:
-		DeviceAlarms::createAlternatorAlarms(service, mNotifications);
+		new BatteryAlarms(service, mNotifications);
 		break;
 	case VenusServiceType::MULTI:
 		new VebusAlarms(service, mNotifications);
 		break;
-	case VenusServiceType::MULTI_RS:
-		DeviceAlarms::createMultiRsAlarms(service, mNotifications);
-		break;
-	case VenusServiceType::SOLAR_CHARGER:
-		DeviceAlarms::createSolarChargerAlarms(service, mNotifications);
-		break;
-	case VenusServiceType::AC_CHARGER:
-		DeviceAlarms::createAcChargerAlarms(service, mNotifications);
-		break;
-	case VenusServiceType::INVERTER:
-		DeviceAlarms::createInverterAlarms(service, mNotifications);
-		break;
-	case VenusServiceType::SYSTEM_CALC:
-		DeviceAlarms::createSystemCalcAlarms(service, mNotifications);
-		break;
-	case VenusServiceType::GENERATOR_STARTSTOP:
-		DeviceAlarms::createGeneratorStartStopAlarms(service, mNotifications);
-		break;
 	case VenusServiceType::GENSET:
 	case VenusServiceType::DCGENSET:
 		new GensetAlarms(service, mNotifications);
 		break;
-	case VenusServiceType::DIGITAL_INPUT:
-		DeviceAlarms::createDigitalInputAlarms(service, mNotifications);
-		break;
-	case VenusServiceType::VECAN:
-		DeviceAlarms::createVecanAlarms(service, mNotifications);
-		break;
-	case VenusServiceType::HUB4:
-		DeviceAlarms::createEssAlarms(service, mNotifications);
-		break;
-	case VenusServiceType::TANK:
-		DeviceAlarms::createTankAlarms(service, mNotifications);
-		break;
-	case VenusServiceType::DC_DC:
-		DeviceAlarms::createDcdcAlarms(service, mNotifications);
-		break;
-	case VenusServiceType::PLATFORM:
-		DeviceAlarms::createPlatformAlarms(service, mNotifications);
-		break;
-	case VenusServiceType::TEMPERATURE_SENSOR:
-		DeviceAlarms::createTemperatureSensorAlarms(service, mNotifications);
-		break;
 	default:
-		;
+	{
+		AlarmTable const *table = AlarmTables::forService(service->getType());
+		if (table) {
+			DeviceAlarms *alarms = new DeviceAlarms(service, mNotifications);
+			alarms->addAlarms(*table);
+		}
+	}
 	}
 }
@@ -1,13 +1,18 @@
 #pragma once
 
 #include <QObject>
+#include <QTimer>
 
 #include <veutil/qt/ve_qitem.hpp>
 
 #include "alarm_monitor.hpp"
+#include "alarm_tables.hpp"
+#include "notifications.hpp"
 #include "venus_services.hpp"
 
-// Object containing the alarms being monitored in a certain service
+// Object containing the alarms being monitored in a certain service. The alarms are
+// added from static tables, their state is kept in a flat array and all changes of the
+// service are handled by the slots of this single object.
 class DeviceAlarms : public QObject {
 	Q_OBJECT
 
@@ -17,43 +22,45 @@ public:
 		mService(service),
 		mNotifications(notifications)
 	{
+		mDebounceTimer.setSingleShot(true);
+		connect(&mDebounceTimer, SIGNAL(timeout()), SLOT(onDebounceTimeout()));
 	}
 
-	virtual ~DeviceAlarms() = default; // To allow dynamic_cast
-
-	/* ok, warning, alarm types */
-	WarningAlarmMonitor *addTripplet(const QString &description, const QString &busitemPathAlarm,
-							VeQItem *busitemSetting = nullptr, const QString &busitemPathValue = "");
-	void addErrorFlag(const QString &description, const QString &busitemPathAlarm, VeQItem *busitemSetting);
-	void addVebusError(const QString &busitemPathAlarm);
-	void addBmsError(const QString &busitemPathAlarm);
-	void addChargerError(const QString &busitemPathAlarm);
-	void addAlternatorError(const QString &busitemPathAlarm);
-	void addGensetError(const QString &busitemPathAlarm);
-
-	static DeviceAlarms *createBatteryAlarms(VenusService *service, Notifications *notifications);
-	static DeviceAlarms *createSolarChargerAlarms(VenusService *service, Notifications *notifications);
-	static DeviceAlarms *createAcChargerAlarms(VenusService *service, Notifications *notifications);
-	static DeviceAlarms *createInverterAlarms(VenusService *service, Notifications *notifications);
-	static DeviceAlarms *createMultiRsAlarms(VenusService *service, Notifications *notifications);
-	static DeviceAlarms *createSystemCalcAlarms(VenusService *service, Notifications *notifications);
-	static DeviceAlarms *createGeneratorStartStopAlarms(VenusService *service, Notifications *notifications);
-	static DeviceAlarms *createDigitalInputAlarms(VenusService *service, Notifications *notifications);
-	static DeviceAlarms *createVecanAlarms(VenusService *service, Notifications *notifications);
-	static DeviceAlarms *createEssAlarms(VenusService *service, Notifications *notifications);
-	static DeviceAlarms *createTankAlarms(VenusService *service, Notifications *notifications);
-	static DeviceAlarms *createDcMeterAlarms(VenusService *service, Notifications *notifications);
-	static DeviceAlarms *createAlternatorAlarms(VenusService *service, Notifications *notifications);
-	static DeviceAlarms *createDcdcAlarms(VenusService *service, Notifications *notifications);
-	static DeviceAlarms *createPlatformAlarms(VenusService *service, Notifications *notifications);
-	static DeviceAlarms *createTemperatureSensorAlarms(VenusService *service, Notifications *notifications);
+	virtual ~DeviceAlarms();
 
+	void addAlarms(AlarmTable const &table);
 	Notifications *notifications() { return mNotifications; }
 
+	virtual int nrOfPhases() const { return 0; }
+	virtual bool singlePhase() const { return false; }
+
+private slots:
+	void onTriggerChanged(QVariant var);
+	void onSettingChanged(QVariant var);
+	void onSettingStateChanged(VeQItem::State state);
+	void onNotificationDestroyed(QObject *object);
+	void onPresenceChanged();
+	void armPresent();
+	void onDebounceTimeout();
+
 protected:
 	VenusService *mService;
-	std::vector<AlarmMonitor *> mAlarms;
+	std::vector<AlarmMonitor> mAlarms;
 	Notifications *mNotifications;
+
+private:
+	VeQItem *presentItem(char const *path);
+	void arm(AlarmMonitor &alarm, VeQItem *trigger);
+	void reportArmed();
+	void updateAlarm(AlarmMonitor &alarm, QVariant const &var);
+	void scheduleDebounce(int ms);
+	void notified(bool added);
+
+	QTimer mDebounceTimer;
+	int mUnarmed = 0;
+	bool mArmedReported = false;
+	qint64 mTriggerTime = 0;
+	bool mArmScheduled = false;
 };
 
 class mk3FirmwareUpdateNotification;
@@ -64,12 +71,7 @@ class VebusAlarms : public DeviceAlarms {
 public:
 	VebusAlarms(VenusService *service, Notifications *notifications);
 
-	QString highTempTextL1(bool single) { return single ? tr("High Temperature") : tr("High Temperature on L1"); }
-	QString inverterOverloadTextL1(bool single) { return single ? tr("Inverter overload") : tr("Inverter overload on L1"); }
-
-	void init(bool single);
-
-	void update(bool single);
+	bool singlePhase() const override { return mSinglePhase; }
 
 private slots:
 	void numberOfPhasesChanged(QVariant var);
@@ -78,8 +80,8 @@ private slots:
 private:
 	VeQItem *mNumberOfPhases;
 	VeQItem *mConnectionType;
-	WarningAlarmMonitor *highTempTextL1Alarm;
-	WarningAlarmMonitor *inverterOverloadTextL1Alarm;
+	bool mSinglePhase = false;
+	bool mInitialized = false;
 
 	friend class mk3FirmwareUpdateNotification;
 };
@@ -90,6 +92,7 @@ class mk3FirmwareUpdateNotification : public QObject
 
 public:
 	mk3FirmwareUpdateNotification(VebusAlarms *alarms) :
+		QObject(alarms),
 		mVebusAlarms(alarms)
 	{
 		mk3Version = alarms->mService->item("Interfaces/Mk2/Version");
@@ -168,7 +171,7 @@ class GensetAlarms : public DeviceAlarms {
 public:
 	GensetAlarms(VenusService *service, Notifications *notifications);
 
-	int nrOfPhases() { return mNumberOfPhases; }
+	int nrOfPhases() const override { return mNumberOfPhases; }
 
 private slots:
 	void numberOfPhasesChanged(QVariant var);
@@ -1,5 +1,6 @@
+#include <QCoreApplication>
+
 #include "alarm_monitor.hpp"
-#include "alarm_item.hpp"
 
 #include <veutil/qt/alternator_error.hpp>
 #include <veutil/qt/charger_error.hpp>
@@ -7,66 +8,36 @@
 #include <veutil/qt/genset_error.hpp>
 #include <veutil/qt/vebus_error.hpp>
 
-AlarmMonitor::AlarmMonitor(VenusService *service, Type type, const QString &busitemPathAlarm, const QString &description,
-			VeQItem *alarmEnableItem, const QString &alarmValuePath, DeviceAlarms *parent) :
-	QObject(parent), mService(service), mNotification(0), mAlarmTrigger(0), mType(type),
-	mDeviceAlarms(parent), mBusitemPathAlarm(busitemPathAlarm), mDescription(description)
+QString AlarmMonitor::description(bool singlePhase) const
 {
-	// Alarms can optionally be enabled / supressed by a setting, but the setting is not necessarily present
-	if (alarmEnableItem != nullptr) {
-		mEnabledNotifications = NO_ALARM;
-		connect(alarmEnableItem, SIGNAL(stateChanged(VeQItem::State)), this, SLOT(settingStateChanged(VeQItem::State)));
-		// Get the value, this will trigger a settingStateChanged event
-		alarmEnableItem->getValueAndChanges(this, SLOT(settingChanged(QVariant)));
-	} else {
-		mEnabledNotifications = ALARM_AND_WARNING;
-	}
-
-	// Optionally an value can be associated with an alarm, e.g. voltage
-	// for an low voltage alarm.
-	if (!alarmValuePath.isEmpty()) {
-		mBusitemValue = service->item(alarmValuePath);
-		mBusitemValue->getText();
-	} else {
-		mBusitemValue = new VeQItem(0, this);
-	}
-
-	// The actual trigger of the alarm, see Type for the supported formats.
-	mAlarmTrigger = service->item(busitemPathAlarm);
-	mAlarmTrigger->getValueAndChanges(this, SLOT(updateAlarm(QVariant)));
+	char const *text = definition->description;
+	if (singlePhase && definition->singlePhaseDescription)
+		text = definition->singlePhaseDescription;
+
+	QString ret = QCoreApplication::translate(context, text);
+	if (definition->descriptionArg)
+		ret = ret.arg(QChar(definition->descriptionArg));
+	return ret;
 }
 
-AlarmMonitor::~AlarmMonitor()
-{
-	if (mNotification)
-		mNotification->setActive(false);
-}
-
-bool AlarmMonitor::mustBeShown(DbusAlarm alarm)
+bool AlarmMonitor::mustBeShown(DbusAlarm alarm) const
 {
 	if (alarm == DBUS_NO_ERROR)
 		return false;
 
-	if (mEnabledNotifications == ALARM_ONLY && alarm == DBUS_WARNING)
+	if (enabled == ALARM_ONLY && alarm == DBUS_WARNING)
 		return false;
 
 	return true;
 }
 
-void AlarmMonitor::updateAlarm(QVariant var)
+// Maps the value of the trigger to a warning / alarm, see Type for the supported formats.
+// The error types replace the description with the one of the error code.
+AlarmMonitor::DbusAlarm AlarmMonitor::evaluate(QVariant const &var, int nrOfPhases, QString *description) const
 {
-	// If there was a previous warning / error it is no longer valid
-	if (mNotification) {
-		mNotification->setActive(false);
-		mNotification->disconnect(this);
-		mNotification = 0;
-	}
-
-	if (!var.isValid() || mEnabledNotifications == NO_ALARM)
-		return;
-
 	DbusAlarm alarm = DBUS_NO_ERROR;
-	switch (mType)
+
+	switch (definition->type)
 	{
 	case REGULAR:
 		alarm = static_cast<DbusAlarm>(var.toInt());
@@ -78,7 +49,7 @@ void AlarmMonitor::updateAlarm(QVariant var)
 			alarm = DBUS_NO_ERROR;
 		} else {
 			alarm = DBUS_ERROR;
-			mDescription = VebusError::getDescription(vebusErrorCode);
+			*description = VebusError::getDescription(vebusErrorCode);
 		}
 		break;
 	}
@@ -89,7 +60,7 @@ void AlarmMonitor::updateAlarm(QVariant var)
 			alarm = DBUS_NO_ERROR;
 		} else {
 			alarm = DBUS_ERROR;
-			mDescription = BmsError::getDescription(error);
+			*description = BmsError::getDescription(error);
 		}
 		break;
 	}
@@ -100,7 +71,7 @@ void AlarmMonitor::updateAlarm(QVariant var)
 			alarm = DBUS_NO_ERROR;
 		} else {
 			alarm = ChargerError::isWarning(error) ? DBUS_WARNING : DBUS_ERROR;
-			mDescription = ChargerError::getDescription(error);
+			*description = ChargerError::getDescription(error);
 		}
 		break;
 	}
@@ -111,7 +82,7 @@ void AlarmMonitor::updateAlarm(QVariant var)
 			alarm = DBUS_NO_ERROR;
 		} else {
 			alarm = error.contains(":e-") ? DBUS_ERROR : DBUS_WARNING;
-			mDescription = AlternatorError::getDescription(error);
+			*description = AlternatorError::getDescription(error);
 		}
 		break;
 	}
@@ -121,9 +92,8 @@ void AlarmMonitor::updateAlarm(QVariant var)
 		if (error == "") {
 			alarm = DBUS_NO_ERROR;
 		} else {
-			auto *ga = dynamic_cast<GensetAlarms *>(mDeviceAlarms);
 			alarm = error.contains(":e-") ? DBUS_ERROR : DBUS_WARNING;
-			mDescription = GensetError::getDescription(error, ga != nullptr ? ga->nrOfPhases() : 0);
+			*description = GensetError::getDescription(error, nrOfPhases);
 		}
 		break;
 	}
@@ -134,42 +104,5 @@ void AlarmMonitor::updateAlarm(QVariant var)
 		break;
 	}
 
-	if (!mustBeShown(alarm))
-		return;
-
-	if (alarm == DBUS_WARNING)
-		addNotification(Notification::WARNING);
-	else
-		addNotification(Notification::ALARM);
-}
-
-// Copied to mEnabledNotifications since having the enabled as a setting is optional
-void AlarmMonitor::settingChanged(QVariant var)
-{
-	mEnabledNotifications = static_cast<Enabled>(var.toInt());
-	if (mAlarmTrigger)
-		updateAlarm(mAlarmTrigger->getValue());
-}
-
-void AlarmMonitor::settingStateChanged(VeQItem::State state)
-{
-	if (state != VeQItem::Offline)
-		return;
-
-	/* Setting not present, allow warnings and alarms */
-	mEnabledNotifications = ALARM_AND_WARNING;
-	disconnect(sender(), SIGNAL(stateChanged(VeQItem::State)), this, SLOT(settingStateChanged(VeQItem::State)));
-}
-
-void AlarmMonitor::addNotification(Notification::Type type)
-{
-	mNotification = mDeviceAlarms->notifications()->addNotification(type, mService->getDescription(),
-																		mBusitemValue->getText(), mDescription,
-																	mBusitemPathAlarm, mAlarmTrigger->getValue(), mService->getName());
-	connect(mNotification, SIGNAL(destroyed()), this, SLOT(notificationDestroyed()));
-}
-
-void AlarmMonitor::notificationDestroyed()
-{
-	mNotification = 0;
+	return alarm;
 }
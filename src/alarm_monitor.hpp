@@ -1,19 +1,37 @@
 #pragma once
 
-#include <QObject>
+#include <QString>
+#include <QVariant>
+
 #include <veutil/qt/ve_qitem.hpp>
 
 #include "notification.hpp"
-#include "notifications.hpp"
-#include "venus_services.hpp"
 
-class DeviceAlarms;
+// The static description of an alarm. These are constexpr tables, see alarm_tables.cpp,
+// so they live in the readonly data and are shared by all services of a type.
+struct AlarmDefinition
+{
+	int type; // AlarmMonitor::Type
+	char const *description;
+	char const *singlePhaseDescription; // the description for single phase systems, if different
+	char descriptionArg; // replaces %1 in the description, if set
+	char const *path;
+	char const *setting; // enables warnings / alarms, optional
+	bool systemSetting; // setting is in com.victronenergy.settings instead of the service
+	char const *valuePath; // optional
+};
 
-class AlarmMonitor : public QObject
+struct AlarmTable
 {
-	Q_OBJECT
+	char const *context; // translation context of the descriptions
+	AlarmDefinition const *alarms;
+	int count;
+};
 
-public:
+// The runtime state of an alarm of a service. This is a plain record, the changes are
+// dispatched by the DeviceAlarms of the service it belongs to.
+struct AlarmMonitor
+{
 	enum Type {
 		REGULAR,
 		VEBUS_ERROR,
@@ -36,50 +54,17 @@ public:
 		DBUS_ERROR
 	};
 
-	explicit AlarmMonitor(VenusService *service, Type type, const QString &busitemPathAlarm,
-						  const QString &description = "", VeQItem *busitemSetting = nullptr,
-						  const QString &busitemPathValue = "", DeviceAlarms *parent = 0);
-
-	~AlarmMonitor();
-	void setDescription(QString description) { mDescription = description; }
-
-	QString serviceDescription() const { return mService->getDescription(); }
-
-private slots:
-	void notificationDestroyed();
-	void settingChanged(QVariant var);
-	void settingStateChanged(VeQItem::State state);
-	void updateAlarm(QVariant var);
-
-private:
-	VenusService *mService;
-	Notification *mNotification;
-	VeQItem *mBusitemValue;
-	VeQItem *mAlarmTrigger;
-	Type mType;
-	Enabled mEnabledNotifications;
-	DeviceAlarms *mDeviceAlarms;
-	QString mBusitemPathAlarm;
-	QString mDescription;
-
-	bool mustBeShown(DbusAlarm alarm);
-	void addNotification(Notification::Type type);
-};
-
-class WarningAlarmMonitor : public AlarmMonitor
-{
-	Q_OBJECT
-
-public:
-	WarningAlarmMonitor(VenusService *service, Type type, const QString &busitemPathAlarm,
-							  const QString &description = "", VeQItem *busitemSetting = nullptr,
-							  const QString &busitemPathValue = "", DeviceAlarms *parent = 0)
-		: AlarmMonitor(service, type, busitemPathAlarm, description, busitemSetting, busitemPathValue, parent)
-	{
-	}
-
-	void setDescription(QString description) { mDescription = description; }
-
-private:
-	QString mDescription;
+	AlarmDefinition const *definition;
+	char const *context;
+	VeQItem *trigger;
+	VeQItem *value;
+	VeQItem *setting;
+	Notification *notification;
+	qint64 clearedAt; // monotonic ms, when the notification became inactive
+	qint64 pendingSince; // monotonic ms, while debouncing
+	quint8 enabled;
+
+	DbusAlarm evaluate(QVariant const &var, int nrOfPhases, QString *description) const;
+	bool mustBeShown(DbusAlarm alarm) const;
+	QString description(bool singlePhase) const;
 };
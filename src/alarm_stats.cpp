@@ -0,0 +1,124 @@
+#include <malloc.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <QFile>
+
+#include "alarm_stats.hpp"
+#include "item_id.hpp"
+#include "startup_timeline.hpp"
+#include "venus_service.hpp"
+
+AlarmStats *AlarmStats::sInstance = nullptr;
+
+AlarmStats::AlarmStats(VeQItem *parentItem, QObject *parent) :
+	QObject(parent),
+	mAlarmsItem(parentItem->itemGetOrCreate("Debug/Alarms")),
+	mProcessItem(parentItem->itemGetOrCreate("Debug/Process")),
+	mTriggerToNotification(mAlarmsItem->itemGetOrCreate("Latency/TriggerToNotification")),
+	mTriggerToAlarm(mAlarmsItem->itemGetOrCreate("Latency/TriggerToAlarm")),
+	mAlarmToRelay(parentItem->itemGetOrCreate("Debug/Latency/AlarmToRelay")),
+	mAlarmToBuzzer(parentItem->itemGetOrCreate("Debug/Latency/AlarmToBuzzer")),
+	mRecentAlarmToRelay(parentItem->itemGetOrCreate("Debug/Latency/AlarmToRelay/Recent")),
+	mRecentAlarmToBuzzer(parentItem->itemGetOrCreate("Debug/Latency/AlarmToBuzzer/Recent")),
+	mDiscoveryToArmed(mAlarmsItem->itemGetOrCreate("Latency/DiscoveryToArmed"))
+{
+	sInstance = this;
+
+	mTimer.setInterval(5000);
+	connect(&mTimer, SIGNAL(timeout()), SLOT(publish()));
+	mTimer.start();
+	publish();
+}
+
+void AlarmStats::publish()
+{
+	mAlarmsItem->itemGetOrCreateAndProduce("Armed", mArmed);
+	mAlarmsItem->itemGetOrCreateAndProduce("Unarmed", mUnarmed);
+	mAlarmsItem->itemGetOrCreateAndProduce("Triggers", mTriggers);
+	mAlarmsItem->itemGetOrCreateAndProduce("NotificationsAdded", mAdded);
+	mAlarmsItem->itemGetOrCreateAndProduce("NotificationsRepeated", mRepeated);
+	mAlarmsItem->itemGetOrCreateAndProduce("RelayWritesSkipped", mRelayWritesSkipped);
+	mAlarmsItem->itemGetOrCreateAndProduce("ServicesReclaimed", mReclaimed);
+	mTriggerToNotification.publish();
+	mTriggerToAlarm.publish();
+	mAlarmToRelay.publish();
+	mAlarmToBuzzer.publish();
+	mRecentAlarmToRelay.publish();
+	mRecentAlarmToBuzzer.publish();
+	mDiscoveryToArmed.publish();
+
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		qint64 ms = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000LL +
+				(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+		mProcessItem->itemGetOrCreateAndProduce("CpuTime", ms);
+	}
+
+	// The second field of statm is the resident set size in pages.
+	QFile statm("/proc/self/statm");
+	if (statm.open(QIODevice::ReadOnly)) {
+		QList<QByteArray> fields = statm.readAll().split(' ');
+		if (fields.size() > 1)
+			mProcessItem->itemGetOrCreateAndProduce("Rss", fields[1].toLongLong() * sysconf(_SC_PAGESIZE) / 1024);
+	}
+
+	mProcessItem->itemGetOrCreateAndProduce("VenusServices", VenusService::instances());
+
+	// The bytes allocated with malloc / new and not freed, in kB.
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	struct mallinfo2 heap = mallinfo2();
+	mProcessItem->itemGetOrCreateAndProduce("HeapInUse", static_cast<qint64>(heap.uordblks / 1024));
+#elif defined(__GLIBC__)
+	struct mallinfo heap = mallinfo();
+	mProcessItem->itemGetOrCreateAndProduce("HeapInUse", static_cast<qint64>(static_cast<unsigned>(heap.uordblks) / 1024));
+#endif
+}
+
+// The alarm was raised by the trigger change being handled, if any, the relay and buzzer
+// should follow. If they don't, e.g. the relay has another function, nothing is recorded.
+void AlarmStats::alarmChanged(bool alarm)
+{
+	if (alarm && mTriggerTime)
+		mTriggerToAlarm.add(StartupTimeline::now() - mTriggerTime);
+
+	mRelayPending = alarm ? mTriggerTime : 0;
+	mBuzzerPending = alarm ? mTriggerTime : 0;
+}
+
+void AlarmStats::relaySwitched()
+{
+	if (!mRelayPending)
+		return;
+
+	qint64 us = StartupTimeline::now() - mRelayPending;
+	mAlarmToRelay.add(us);
+	mRecentAlarmToRelay.add(us);
+	mRelayPending = 0;
+}
+
+void AlarmStats::buzzerSwitched()
+{
+	if (!mBuzzerPending)
+		return;
+
+	qint64 us = StartupTimeline::now() - mBuzzerPending;
+	mAlarmToBuzzer.add(us);
+	mRecentAlarmToBuzzer.add(us);
+	mBuzzerPending = 0;
+}
+
+void AlarmStats::serviceArmed(QString const &service, qint64 us)
+{
+	mDiscoveryToArmed.add(us);
+	mAlarmsItem->itemGetOrCreateAndProduce("Services/" + itemId(service) + "/TimeToArmed", us / 1000);
+}
+
+void AlarmStats::serviceReclaimed(QString const &service)
+{
+	mReclaimed++;
+
+	VeQItem *item = mAlarmsItem->itemGet("Services/" + itemId(service));
+	if (item)
+		item->itemDelete();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+
+#include <veutil/qt/ve_qitem.hpp>
+
+#include "latency_histogram.hpp"
+
+// Figures to size installations with many devices: how many alarms are monitored,
+// how often they trigger, the latency from a trigger change to the notification and
+// the cpu time and memory of the process. Exported in Debug/Alarms and Debug/Process,
+// at most every publish interval, so a load test doesn't measure its own D-Bus traffic.
+//
+// Latency/TriggerToAlarm is the time from a trigger change until /Notifications/Alarm is
+// set by it, Debug/Process/HeapInUse the memory allocated and not freed and VenusServices
+// the number of VenusService objects alive, see also the load test in tests/alarm_load.
+//
+// Debug/Alarms/Services/<service>/TimeToArmed is the time in ms from the service
+// appearing on the bus until the alarms it has are armed, DiscoveryToArmed the histogram
+// of it. ServicesReclaimed counts the services removed after being offline for too long,
+// see VenusServices, their entry in Services is removed as well.
+//
+// Debug/Latency has the time from the trigger change which raised the alarm until the
+// alarm relay and buzzer are written. Alarms raised otherwise, e.g. after debouncing,
+// are not included, like for TriggerToNotification. Their Recent child has the same for
+// the last 10 to 20 minutes only.
+class AlarmStats : public QObject
+{
+	Q_OBJECT
+
+public:
+	AlarmStats(VeQItem *parentItem, QObject *parent = 0);
+	static AlarmStats *instance() { return sInstance; }
+
+	void armed(int n = 1) { mArmed += n; }
+	void unarmed(int n = 1) { mUnarmed += n; }
+	void triggered() { mTriggers++; }
+	void notificationAdded() { mAdded++; }
+	void notificationRepeated() { mRepeated++; }
+	void triggerToNotification(qint64 us) { mTriggerToNotification.add(us); }
+
+	// The trigger change being handled, StartupTimeline::now(), 0 when done.
+	void setTriggerTime(qint64 us) { mTriggerTime = us; }
+	void alarmChanged(bool alarm);
+	void relaySwitched();
+	void buzzerSwitched();
+	void relayWriteSkipped() { mRelayWritesSkipped++; }
+	void serviceArmed(QString const &service, qint64 us);
+	void serviceReclaimed(QString const &service);
+
+private slots:
+	void publish();
+
+private:
+	static AlarmStats *sInstance;
+
+	VeQItem *mAlarmsItem;
+	VeQItem *mProcessItem;
+	QTimer mTimer;
+	int mArmed = 0;
+	int mUnarmed = 0;
+	quint64 mTriggers = 0;
+	quint64 mAdded = 0;
+	quint64 mRepeated = 0;
+	quint64 mRelayWritesSkipped = 0;
+	quint64 mReclaimed = 0;
+	qint64 mTriggerTime = 0;
+	qint64 mRelayPending = 0;
+	qint64 mBuzzerPending = 0;
+	LatencyHistogram mTriggerToNotification;
+	LatencyHistogram mTriggerToAlarm;
+	LatencyHistogram mAlarmToRelay;
+	LatencyHistogram mAlarmToBuzzer;
+	WindowedLatencyHistogram mRecentAlarmToRelay;
+	WindowedLatencyHistogram mRecentAlarmToBuzzer;
+	LatencyHistogram mDiscoveryToArmed;
+};
@@ -0,0 +1,258 @@
+#include <QByteArray>
+#include <QList>
+#include <QtGlobal>
+
+#include <vector>
+
+#include "alarm_tables.hpp"
+
+#define ALARM_TABLE(context, alarms) { context, alarms, sizeof(alarms) / sizeof(alarms[0]) }
+
+// type, description, single phase description, description argument, trigger, setting, system setting, value
+static constexpr AlarmDefinition batteryAlarms[] = {
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "Low voltage"),					nullptr, 0,	"/Alarms/LowVoltage",							nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "High voltage"),					nullptr, 0,	"/Alarms/HighVoltage",							nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "High cell voltage"),			nullptr, 0,	"/Alarms/HighCellVoltage",						nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "High current"),					nullptr, 0,	"/Alarms/HighCurrent",							nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "High charge current"),			nullptr, 0,	"/Alarms/HighChargeCurrent",					nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "High discharge current"),		nullptr, 0,	"/Alarms/HighDischargeCurrent",					nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "High charge temperature"),		nullptr, 0,	"/Alarms/HighChargeTemperature",				nullptr, false,	"/Dc/0/Temperature" },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "Low charge temperature"),		nullptr, 0,	"/Alarms/LowChargeTemperature",					nullptr, false,	"/Dc/0/Temperature" },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "Low SOC"),						nullptr, 0,	"/Alarms/LowSoc",								nullptr, false,	"/Soc" },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "State of health"),				nullptr, 0,	"/Alarms/StateOfHealth",						nullptr, false,	"/Soh" },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "Low starter voltage"),			nullptr, 0,	"/Alarms/LowStarterVoltage",					nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "High starter voltage"),			nullptr, 0,	"/Alarms/HighStarterVoltage",					nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "Low temperature"),				nullptr, 0,	"/Alarms/LowTemperature",						nullptr, false,	"/Dc/0/Temperature" },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "High Temperature"),				nullptr, 0,	"/Alarms/HighTemperature",						nullptr, false,	"/Dc/0/Temperature" },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "Mid-point voltage"),			nullptr, 0,	"/Alarms/MidVoltage",							nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "Low-fused voltage"),			nullptr, 0,	"/Alarms/LowFusedVoltage",						nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "High-fused voltage"),			nullptr, 0,	"/Alarms/HighFusedVoltage",						nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "Fuse blown"),					nullptr, 0,	"/Alarms/FuseBlown",							nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "High internal temperature"),	nullptr, 0,	"/Alarms/HighInternalTemperature",				nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "Internal failure"),				nullptr, 0,	"/Alarms/InternalFailure",						nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "Battery temperature sensor"),	nullptr, 0,	"/Alarms/BatteryTemperatureSensor",				nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "Cell imbalance"),				nullptr, 0,	"/Alarms/CellImbalance",						nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "Low cell voltage"),				nullptr, 0,	"/Alarms/LowCellVoltage",						nullptr, false,	"/System/MinCellVoltage" },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "Bad contactor"),				nullptr, 0,	"/Alarms/Contactor",							nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("BatteryAlarms", "BMS cable fault"),				nullptr, 0,	"/Alarms/BmsCable",								nullptr, false,	nullptr },
+	{ AlarmMonitor::ERROR_FLAG,	QT_TRANSLATE_NOOP("BatteryAlarms", "Communication error"),			nullptr, 0,	"/Errors/SmartLithium/Communication",			nullptr, false,	nullptr },
+	{ AlarmMonitor::ERROR_FLAG,	QT_TRANSLATE_NOOP("BatteryAlarms", "Invalid battery configuration"),nullptr, 0,	"/Errors/SmartLithium/InvalidConfiguration",	nullptr, false,	nullptr },
+	{ AlarmMonitor::ERROR_FLAG,	QT_TRANSLATE_NOOP("BatteryAlarms", "Incorrect number of batteries"),nullptr, 0,	"/Errors/SmartLithium/NrOfBatteries",			nullptr, false,	nullptr },
+	{ AlarmMonitor::ERROR_FLAG,	QT_TRANSLATE_NOOP("BatteryAlarms", "Battery voltage not supported"),nullptr, 0,	"/Errors/SmartLithium/Voltage",					nullptr, false,	nullptr },
+	{ AlarmMonitor::BMS_ERROR,	"",																	nullptr, 0,	"/ErrorCode",									nullptr, false,	nullptr },
+};
+
+static constexpr AlarmDefinition generatorStartStopAlarms[] = {
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "Generator not detected at AC input"),		nullptr, 0,	"/Alarms/NoGeneratorAtAcIn",		nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "Service interval exceeded"),					nullptr, 0,	"/Alarms/ServiceIntervalExceeded",	nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "GX Auto start/stop is disabled"),			nullptr, 0,	"/Alarms/AutoStartDisabled",		nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "Remote start is disabled on the genset"),	nullptr, 0,	"/Alarms/RemoteStartModeDisabled",	nullptr, false,	nullptr },
+};
+
+static constexpr AlarmDefinition digitalInputAlarms[] = {
+	{ AlarmMonitor::REGULAR,	"",	nullptr, 0,	"/Alarm",	nullptr, false,	nullptr },
+};
+
+static constexpr AlarmDefinition solarChargerAlarms[] = {
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("DeviceAlarms", "Low battery voltage"),	nullptr, 0,	"/Alarms/LowVoltage",		nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("DeviceAlarms", "High battery voltage"),	nullptr, 0,	"/Alarms/HighVoltage",		nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("DeviceAlarms", "High temperature"),		nullptr, 0,	"/Alarms/HighTemperature",	nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("DeviceAlarms", "Short circuit"),			nullptr, 0,	"/Alarms/ShortCircuit",		nullptr, false,	nullptr },
+	{ AlarmMonitor::CHARGER_ERROR,	"",															nullptr, 0,	"/ErrorCode",				nullptr, false,	nullptr },
+};
+
+static constexpr AlarmDefinition acChargerAlarms[] = {
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("DeviceAlarms", "Low battery voltage"),	nullptr, 0,	"/Alarms/LowVoltage",	nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("DeviceAlarms", "High battery voltage"),	nullptr, 0,	"/Alarms/HighVoltage",	nullptr, false,	nullptr },
+	{ AlarmMonitor::CHARGER_ERROR,	"",															nullptr, 0,	"/ErrorCode",			nullptr, false,	nullptr },
+};
+
+static constexpr AlarmDefinition inverterAlarms[] = {
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "Low battery voltage"),	nullptr, 0,	"/Alarms/LowVoltage",		"/Settings/AlarmLevel/LowVoltage",			false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "High battery voltage"),	nullptr, 0,	"/Alarms/HighVoltage",		"/Settings/AlarmLevel/HighVoltage",			false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "Low AC voltage"),		nullptr, 0,	"/Alarms/LowVoltageAcOut",	"/Settings/AlarmLevel/LowVoltageAcOut",		false,	"/Ac/Out/L1/V" },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "High AC voltage"),		nullptr, 0,	"/Alarms/HighVoltageAcOut",	"/Settings/AlarmLevel/HighVoltageAcOut",	false,	"/Ac/Out/L1/V" },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "Low temperature"),		nullptr, 0,	"/Alarms/LowTemperature",	nullptr,									false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "High temperature"),		nullptr, 0,	"/Alarms/HighTemperature",	"/Settings/AlarmLevel/HighTemperature",		false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "Inverter overload"),		nullptr, 0,	"/Alarms/Overload",			"/Settings/AlarmLevel/Overload",			false,	"/Ac/Out/L1/I" },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "High DC ripple"),		nullptr, 0,	"/Alarms/Ripple",			"/Settings/AlarmLevel/Ripple",				false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "Low SOC"),				nullptr, 0,	"/Alarms/LowSoc",			"/Settings/AlarmLevel/LowSoc",				false,	"/Soc" },
+};
+
+// Note: single phase is not always on L1, so there are no values for the AC alarms.
+static constexpr AlarmDefinition multiRsAlarms[] = {
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("DeviceAlarms", "Low battery voltage"),	nullptr, 0,	"/Alarms/LowVoltage",		"/Settings/AlarmLevel/LowVoltage",			false,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("DeviceAlarms", "High battery voltage"),	nullptr, 0,	"/Alarms/HighVoltage",		"/Settings/AlarmLevel/HighVoltage",			false,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("DeviceAlarms", "Low AC voltage"),		nullptr, 0,	"/Alarms/LowVoltageAcOut",	"/Settings/AlarmLevel/LowVoltageAcOut",		false,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("DeviceAlarms", "High AC voltage"),		nullptr, 0,	"/Alarms/HighVoltageAcOut",	"/Settings/AlarmLevel/HighVoltageAcOut",	false,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("DeviceAlarms", "High temperature"),		nullptr, 0,	"/Alarms/HighTemperature",	"/Settings/AlarmLevel/HighTemperature",		false,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("DeviceAlarms", "Inverter overload"),		nullptr, 0,	"/Alarms/Overload",			"/Settings/AlarmLevel/Overload",			false,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("DeviceAlarms", "High DC ripple"),		nullptr, 0,	"/Alarms/Ripple",			"/Settings/AlarmLevel/Ripple",				false,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("DeviceAlarms", "Low SOC"),				nullptr, 0,	"/Alarms/LowSoc",			"/Settings/AlarmLevel/LowSoc",				false,	"/Soc" },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("DeviceAlarms", "Short circuit"),			nullptr, 0,	"/Alarms/ShortCircuit",		"/Settings/AlarmLevel/ShortCircuit",		false,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("DeviceAlarms", "Grid lost"),				nullptr, 0,	"/Alarms/GridLost",			"/Settings/AlarmLevel/GridLost",			false,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("DeviceAlarms", "Phase rotation"),		nullptr, 0,	"/Alarms/PhaseRotation",	"/Settings/AlarmLevel/PhaseRotation",		false,	nullptr },
+	{ AlarmMonitor::CHARGER_ERROR,	"",															nullptr, 0,	"/ErrorCode",				nullptr,									false,	nullptr },
+};
+
+static constexpr AlarmDefinition systemCalcAlarms[] = {
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "Circuit breaker tripped"),				nullptr, 0,	"/Dc/Battery/Alarms/CircuitBreakerTripped",	nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "DVCC with incompatible firmware #48"),	nullptr, 0,	"/Dvcc/Alarms/FirmwareInsufficient",		nullptr, false,	nullptr },
+};
+
+static constexpr AlarmDefinition vecanAlarms[] = {
+	{ AlarmMonitor::REGULAR,	"Please set the VE.Can number to a free one",	nullptr, 0,	"/Alarms/SameUniqueNameUsed",	nullptr, false,	nullptr },
+};
+
+static constexpr AlarmDefinition essAlarms[] = {
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "Grid meter not found #49"),	nullptr, 0,	"/Alarms/NoGridMeter",	nullptr, false,	nullptr },
+};
+
+static constexpr AlarmDefinition tankAlarms[] = {
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "Low level alarm"),	nullptr, 0,	"/Alarms/Low/State",	nullptr, false,	"/Level" },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "High level alarm"),	nullptr, 0,	"/Alarms/High/State",	nullptr, false,	"/Level" },
+};
+
+static constexpr AlarmDefinition dcMeterAlarms[] = {
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "Low voltage"),		nullptr, 0,	"/Alarms/LowVoltage",			nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "High voltage"),		nullptr, 0,	"/Alarms/HighVoltage",			nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "Low aux voltage"),	nullptr, 0,	"/Alarms/LowStarterVoltage",	nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "High aux voltage"),	nullptr, 0,	"/Alarms/HighStarterVoltage",	nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "Low temperature"),	nullptr, 0,	"/Alarms/LowTemperature",		nullptr, false,	"/Dc/0/Temperature" },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "High Temperature"),	nullptr, 0,	"/Alarms/HighTemperature",		nullptr, false,	"/Dc/0/Temperature" },
+};
+
+// The dc meter alarms, with the errors of Victron (Orion XS) and third party (Wakespeed, ARCO, etc) alternators.
+static constexpr AlarmDefinition alternatorAlarms[] = {
+	{ AlarmMonitor::REGULAR,			QT_TRANSLATE_NOOP("DeviceAlarms", "Low voltage"),		nullptr, 0,	"/Alarms/LowVoltage",			nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,			QT_TRANSLATE_NOOP("DeviceAlarms", "High voltage"),		nullptr, 0,	"/Alarms/HighVoltage",			nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,			QT_TRANSLATE_NOOP("DeviceAlarms", "Low aux voltage"),	nullptr, 0,	"/Alarms/LowStarterVoltage",	nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,			QT_TRANSLATE_NOOP("DeviceAlarms", "High aux voltage"),	nullptr, 0,	"/Alarms/HighStarterVoltage",	nullptr, false,	nullptr },
+	{ AlarmMonitor::REGULAR,			QT_TRANSLATE_NOOP("DeviceAlarms", "Low temperature"),	nullptr, 0,	"/Alarms/LowTemperature",		nullptr, false,	"/Dc/0/Temperature" },
+	{ AlarmMonitor::REGULAR,			QT_TRANSLATE_NOOP("DeviceAlarms", "High Temperature"),	nullptr, 0,	"/Alarms/HighTemperature",		nullptr, false,	"/Dc/0/Temperature" },
+	{ AlarmMonitor::CHARGER_ERROR,		"",														nullptr, 0,	"/ErrorCode",					nullptr, false,	nullptr },
+	{ AlarmMonitor::ALTERNATOR_ERROR,	"",														nullptr, 0,	"/Error/0/Id",					nullptr, false,	nullptr },
+};
+
+static constexpr AlarmDefinition dcdcAlarms[] = {
+	{ AlarmMonitor::CHARGER_ERROR,	"",	nullptr, 0,	"/ErrorCode",	nullptr, false,	nullptr },
+};
+
+static constexpr AlarmDefinition platformAlarms[] = {
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "#42 Storage is corrupt on this device"),	nullptr, 0,	"/Device/DataPartitionError",	nullptr, false,	nullptr },
+};
+
+static constexpr AlarmDefinition temperatureSensorAlarms[] = {
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("DeviceAlarms", "Low battery"),	nullptr, 0,	"/Alarms/LowBattery",	nullptr, false,	"/BatteryVoltage" },
+};
+
+static constexpr AlarmDefinition gensetAlarms[] = {
+	{ AlarmMonitor::GENSET_ERROR,	"",	nullptr, 0,	"/Error/0/Id",	nullptr, false,	nullptr },
+};
+
+// Note: the description of the L1 alarms depends on the number of phases.
+static constexpr AlarmDefinition vebusAlarms[] = {
+	{ AlarmMonitor::VEBUS_ERROR,	"",																nullptr,											0,	"/VebusError",					nullptr,										false,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("VebusAlarms", "Temperature sense error"),	nullptr,											0,	"/Alarms/TemperatureSensor",	"Settings/Alarm/Vebus/TemperatureSenseError",	true,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("VebusAlarms", "Voltage sense error"),		nullptr,											0,	"/Alarms/VoltageSensor",		"Settings/Alarm/Vebus/VoltageSenseError",		true,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("VebusAlarms", "Low battery voltage"),		nullptr,											0,	"/Alarms/LowBattery",			"Settings/Alarm/Vebus/LowBattery",				true,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("VebusAlarms", "High DC ripple"),				nullptr,											0,	"/Alarms/Ripple",				"Settings/Alarm/Vebus/HighDcRipple",			true,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("VebusAlarms", "Wrong phase rotation detected"), nullptr,										0,	"/Alarms/PhaseRotation",		nullptr,										false,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("VebusAlarms", "High Temperature on L1"),		QT_TRANSLATE_NOOP("VebusAlarms", "High Temperature"),	0,	"/Alarms/L1/HighTemperature",	"Settings/Alarm/Vebus/HighTemperature",			true,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("VebusAlarms", "Inverter overload on L1"),	QT_TRANSLATE_NOOP("VebusAlarms", "Inverter overload"),	0,	"/Alarms/L1/Overload",			"Settings/Alarm/Vebus/InverterOverload",		true,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("VebusAlarms", "High Temperature on L2"),		nullptr,											0,	"/Alarms/L2/HighTemperature",	"Settings/Alarm/Vebus/HighTemperature",			true,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("VebusAlarms", "Inverter overload on L2"),	nullptr,											0,	"/Alarms/L2/Overload",			"Settings/Alarm/Vebus/InverterOverload",		true,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("VebusAlarms", "High Temperature on L3"),		nullptr,											0,	"/Alarms/L3/HighTemperature",	"Settings/Alarm/Vebus/HighTemperature",			true,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("VebusAlarms", "Inverter overload on L3"),	nullptr,											0,	"/Alarms/L3/Overload",			"Settings/Alarm/Vebus/InverterOverload",		true,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("VebusAlarms", "Grid lost"),					nullptr,											0,	"/Alarms/GridLost",				nullptr,										false,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("VebusAlarms", "High DC voltage"),			nullptr,											0,	"/Alarms/HighDcVoltage",		"Settings/Alarm/Vebus/HighDcVoltage",			true,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("VebusAlarms", "High DC current"),			nullptr,											0,	"/Alarms/HighDcCurrent",		"Settings/Alarm/Vebus/HighDcCurrent",			true,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("VebusAlarms", "BMS pre-alarm"),				nullptr,											0,	"/Alarms/BmsPreAlarm",			nullptr,										false,	nullptr },
+	{ AlarmMonitor::REGULAR,		QT_TRANSLATE_NOOP("VebusAlarms", "BMS connection lost"),		nullptr,											0,	"/Alarms/BmsConnectionLost",	nullptr,										false,	nullptr },
+};
+
+// backwards compatible, the CAN-bus sends these e.g.
+static constexpr AlarmDefinition vebusCanAlarms[] = {
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("VebusAlarms", "High Temperature"),	nullptr, 0,	"/Alarms/HighTemperature",	"Settings/Alarm/Vebus/HighTemperature",		true,	nullptr },
+	{ AlarmMonitor::REGULAR,	QT_TRANSLATE_NOOP("VebusAlarms", "Inverter overload"),	nullptr, 0,	"/Alarms/Overload",			"Settings/Alarm/Vebus/InverterOverload",	true,	nullptr },
+};
+
+static constexpr struct {
+	VenusServiceType type;
+	AlarmTable table;
+} serviceAlarms[] = {
+	{ VenusServiceType::FUEL_CELL,				ALARM_TABLE("DeviceAlarms", dcMeterAlarms) },
+	{ VenusServiceType::DC_SOURCE,				ALARM_TABLE("DeviceAlarms", dcMeterAlarms) },
+	{ VenusServiceType::DC_LOAD,				ALARM_TABLE("DeviceAlarms", dcMeterAlarms) },
+	{ VenusServiceType::DC_SYSTEM,				ALARM_TABLE("DeviceAlarms", dcMeterAlarms) },
+	{ VenusServiceType::ALTERNATOR,				ALARM_TABLE("DeviceAlarms", alternatorAlarms) },
+	{ VenusServiceType::MULTI_RS,				ALARM_TABLE("DeviceAlarms", multiRsAlarms) },
+	{ VenusServiceType::SOLAR_CHARGER,			ALARM_TABLE("DeviceAlarms", solarChargerAlarms) },
+	{ VenusServiceType::AC_CHARGER,				ALARM_TABLE("DeviceAlarms", acChargerAlarms) },
+	{ VenusServiceType::INVERTER,				ALARM_TABLE("DeviceAlarms", inverterAlarms) },
+	{ VenusServiceType::SYSTEM_CALC,			ALARM_TABLE("DeviceAlarms", systemCalcAlarms) },
+	{ VenusServiceType::GENERATOR_STARTSTOP,	ALARM_TABLE("DeviceAlarms", generatorStartStopAlarms) },
+	{ VenusServiceType::DIGITAL_INPUT,			ALARM_TABLE("DeviceAlarms", digitalInputAlarms) },
+	{ VenusServiceType::VECAN,					ALARM_TABLE("DeviceAlarms", vecanAlarms) },
+	{ VenusServiceType::HUB4,					ALARM_TABLE("DeviceAlarms", essAlarms) },
+	{ VenusServiceType::TANK,					ALARM_TABLE("DeviceAlarms", tankAlarms) },
+	{ VenusServiceType::DC_DC,					ALARM_TABLE("DeviceAlarms", dcdcAlarms) },
+	{ VenusServiceType::PLATFORM,				ALARM_TABLE("DeviceAlarms", platformAlarms) },
+	{ VenusServiceType::TEMPERATURE_SENSOR,		ALARM_TABLE("DeviceAlarms", temperatureSensorAlarms) },
+};
+
+AlarmTable const AlarmTables::battery = ALARM_TABLE("BatteryAlarms", batteryAlarms);
+AlarmTable const AlarmTables::genset = ALARM_TABLE("DeviceAlarms", gensetAlarms);
+AlarmTable const AlarmTables::vebus = ALARM_TABLE("VebusAlarms", vebusAlarms);
+AlarmTable const AlarmTables::vebusCan = ALARM_TABLE("VebusAlarms", vebusCanAlarms);
+
+AlarmTable const *AlarmTables::forService(VenusServiceType type)
+{
+	for (auto const &entry: serviceAlarms) {
+		if (entry.type == type)
+			return &entry.table;
+	}
+	return nullptr;
+}
+
+/*
+ * The distributors and fuses of a Lynx BMS. The paths are generated once and shared by
+ * all batteries. All of them are monitored, since /NrOfDistributors reflects the number
+ * of connected distributors, not which ones are connected. I.e. distributor C & D can
+ * be present without A & B being present.
+ */
+AlarmTable const &AlarmTables::distributors()
+{
+	static QList<QByteArray> paths;
+	static std::vector<AlarmDefinition> alarms;
+	static AlarmTable table = { "BatteryAlarms", nullptr, 0 };
+
+	if (table.alarms)
+		return table;
+
+	for (int d = 0; d < 8; d++) {
+		QByteArray const distPath = QByteArray("/Distributor/") + char('A' + d);
+		paths.append(distPath + "/Alarms/ConnectionLost");
+		for (int f = 0; f < 8; f++) {
+			QByteArray const fusePath = distPath + "/Fuse/" + QByteArray::number(f);
+			paths.append(fusePath + "/Alarms/Blown");
+			paths.append(fusePath + "/Name");
+		}
+	}
+
+	int n = 0;
+	for (int d = 0; d < 8; d++) {
+		alarms.push_back({ AlarmMonitor::REGULAR, QT_TRANSLATE_NOOP("BatteryAlarms", "Distributor %1 connection lost"),
+						   nullptr, char('A' + d), paths[n++].constData(), nullptr, false, nullptr });
+		for (int f = 0; f < 8; f++) {
+			char const *trigger = paths[n++].constData();
+			alarms.push_back({ AlarmMonitor::REGULAR, QT_TRANSLATE_NOOP("BatteryAlarms", "Fuse blown"),
+							   nullptr, 0, trigger, nullptr, false, paths[n++].constData() });
+		}
+	}
+
+	table.alarms = alarms.data();
+	table.count = static_cast<int>(alarms.size());
+
+	return table;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <veutil/qt/venus_types.hpp>
+
+#include "alarm_monitor.hpp"
+
+// The alarms monitored per service type. Services with alarms which depend on other
+// values, like the number of phases or distributors, have their own DeviceAlarms and
+// use the named tables.
+class AlarmTables
+{
+public:
+	static AlarmTable const *forService(VenusServiceType type);
+
+	static AlarmTable const battery;
+	static AlarmTable const genset;
+	static AlarmTable const vebus;
+	static AlarmTable const vebusCan;
+	static AlarmTable const &distributors();
+};
@@ -1,4 +1,7 @@
+#include <errno.h>
+#include <sched.h>
 #include <signal.h>
+#include <string.h>
 
 #include <veutil/qt/daemontools_service.hpp>
 #include <veutil/qt/ve_dbus_connection.hpp>
@@ -6,7 +9,14 @@
 #include <veutil/qt/ve_qitem_exported_dbus_services.hpp>
 
 #include "application.hpp"
+#include "alarm_stats.hpp"
+#include "machine_features.hpp"
+#include "process_executor.hpp"
 #include "security_profiles.hpp"
+#include "service_templates.hpp"
+#include "startup.hpp"
+#include "supervise_control.hpp"
+#include "startup_timeline.hpp"
 #include "time.hpp"
 
 #define LYNX_BMS_500 0xA3E5
@@ -14,7 +24,6 @@
 #define LYNX_BMS_1000 0xA3E6
 #define LYNX_BMS_1000_NG 0xA3E7
 
-static QDir machineRuntimeDir = QDir("/etc/venus");
 static QDir venusDir = QDir("/opt/victronenergy");
 QVariant Application::mRunningGui;
 
@@ -23,34 +32,12 @@ bool serviceExists(QString const &svc) {
 }
 
 static bool templateExists(QString const &name) {
-	return QFile("/opt/victronenergy/service-templates/conf/" + name + ".conf").exists();
+	return MachineFeatures::instance()->templateExists(name);
 }
 
 QStringList getFeatureList(QString const &name, bool lines)
 {
-	QStringList ret;
-	QFile file(machineRuntimeDir.filePath(name));
-
-	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
-		return ret;
-
-	QString line;
-	while (!file.atEnd()) {
-		line = file.readLine();
-		if (lines) {
-			line = line.trimmed();
-			if (!line.isEmpty())
-				ret.append(line);
-		} else {
-#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
-			ret.append(line.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts));
-#else
-			ret.append(line.split(QRegExp("\\s+"), QString::SkipEmptyParts));
-#endif
-		}
-	}
-
-	return ret;
+	return MachineFeatures::instance()->list(name, lines);
 }
 
 QString getFeature(QString const &name, bool optional)
@@ -152,29 +139,57 @@ static void cleanDir(const QString &dirName)
 	}
 }
 
+void NodeRedCleaner::clean(QString const &serviceDir)
+{
+	// Like DaemonToolsService::waitTillDown, but without blocking the main thread.
+	for (int n = 0; n < 300 && SuperviseControl::status(serviceDir).isUp(); n++)
+		QThread::msleep(100);
+
+	cleanDir("/data/home/nodered/.cache");
+	cleanDir("/data/home/nodered/.node-red");
+	cleanDir("/data/home/nodered/.npm");
+
+	emit cleaned();
+}
+
 VeQItemNodeRedReset::VeQItemNodeRedReset(DaemonToolsService *nodeRed, VeQItem *nodeRedMode) :
 	mNodeRed(nodeRed),
 	mNodeRedMode(nodeRedMode)
 {
+	mCleaner = new NodeRedCleaner();
+	mCleaner->moveToThread(&mThread);
+	connect(&mThread, SIGNAL(finished()), mCleaner, SLOT(deleteLater()));
+	connect(mCleaner, SIGNAL(cleaned()), this, SLOT(onCleaned()));
+	mThread.start();
+}
+
+VeQItemNodeRedReset::~VeQItemNodeRedReset()
+{
+	mThread.quit();
+	mThread.wait();
 }
 
 int VeQItemNodeRedReset::setValue(const QVariant &value)
 {
-	if (value.toInt() == 1) {
+	if (value.toInt() == 1 && !mBusy) {
 		qDebug() << "Resetting Node Red";
 
+		mBusy = true;
 		mNodeRedMode->setValue(0);
 		mNodeRed->stop();
-		mNodeRed->waitTillDown();
-
-		cleanDir("/data/home/nodered/.cache");
-		cleanDir("/data/home/nodered/.node-red");
-		cleanDir("/data/home/nodered/.npm");
+		QMetaObject::invokeMethod(mCleaner, "clean", Qt::QueuedConnection,
+								  Q_ARG(QString, "/service/node-red-venus"));
 	}
 
 	return VeQItemAction::setValue(value);
 }
 
+void VeQItemNodeRedReset::onCleaned()
+{
+	qDebug() << "Node Red reset done";
+	mBusy = false;
+}
+
 enum Mk3Update {
 	DISALLOWED,
 	ALLOWED,
@@ -188,11 +203,15 @@ public:
 	{
 		QString mBacklightDevice = getFeature("backlight_device");
 
+		add("Alarm/Debounce", 0, 0, 60000);
+		add("Alarm/FlapWindow", 300, 0, 3600);
+		add("Alarm/RealtimePriority", 0, 0, 50);
+		add("Alarm/ServiceGracePeriod", 600, 0, 86400);
 		add("Gps/Format", 0, 0, 0);
 		add("Gps/SpeedUnit", "km/h");
 
 		// Create dbus settings. Do not create settings when capabilities do not exist.
-		if (!getFeature("backlight_device").isEmpty()) {
+		if (!mBacklightDevice.isEmpty()) {
 			int mMaxBrightness = readIntFromFile(mBacklightDevice + "/max_brightness", -1);
 			add("Gui/Brightness", mMaxBrightness, 1, mMaxBrightness);
 
@@ -245,6 +264,9 @@ Application::Application::Application(int &argc, char **argv) :
 	QCoreApplication(argc, argv),
 	mLocalSettingsTimeout()
 {
+	StartupPhase phase("Constructor");
+	StartupTimeline::instance()->begin("LocalSettings");
+
 	QDBusConnection dbus = VeDbusConnection::getConnection();
 	if (!dbus.isConnected()) {
 		qCritical() << "DBus connection failed";
@@ -260,6 +282,7 @@ Application::Application::Application(int &argc, char **argv) :
 	connect(item, SIGNAL(stateChanged(VeQItem::State)), SLOT(onLocalSettingsStateChanged(VeQItem::State)));
 	if (item->getState() == VeQItem::Synchronized) {
 		qDebug() << "Localsettings found";
+		StartupTimeline::instance()->end("LocalSettings");
 		init();
 	} else {
 		qDebug() << "Localsettings not found";
@@ -280,6 +303,7 @@ void Application::onLocalSettingsStateChanged(VeQItem::State state)
 	}
 
 	qDebug() << "Localsettings appeared";
+	StartupTimeline::instance()->end("LocalSettings");
 	init();
 }
 
@@ -301,7 +325,7 @@ void Application::onMk3UpdateAllowedChanged(QVariant var)
 
 	if (lastValue.toInt(&ok) == 0 && ok && var.toInt(&ok) == 1 && ok) {
 		qDebug() << "restarting all Vebus services";
-		spawn("sh", QStringList() << "-c" << "svc -t /service/mk2-dbus.*");
+		SuperviseControl::sendAll("/service", "mk2-dbus.*", "t");
 	}
 
 	lastValue = var;
@@ -342,12 +366,12 @@ void Application::onRunningGuiVersionObtained(QVariant var)
 	// Switch the index page of the webserver as well.
 	// make sure this is also done on device without gui-v2 / screen
 	if (mRunningGuiSetting.isValid() && var.isValid()) {
-		system("/etc/venus/www.d/create-gui-redirect.sh");
+		run("/etc/venus/www.d/create-gui-redirect.sh");
 
 		// Since there is no way for gui-v1 to communicate with the browser,
 		// trigger a disconnect of the VNC connection.
 		if (!mGuiSwitcher && var.toInt() == 2)
-			system("killall websockify");
+			run("killall", QStringList() << "websockify");
 	}
 	mRunningGuiSetting = var;
 
@@ -363,27 +387,32 @@ void Application::onRunningGuiVersionObtained(QVariant var)
 	}
 }
 
-void Application::onServiceAdded(VeQItem *var)
+void Application::onGensetFound(VenusService *service)
 {
-	if (var->id().startsWith("com.victronenergy.genset") || var->id().startsWith("com.victronenergy.dcgenset")) {
-		connect(var, SIGNAL(stateChanged(VeQItem::State)), SLOT(onGensetStateChanged(VeQItem::State)));
-	} else if (var->id().startsWith("com.victronenergy.battery")) {
-		// Need to look at the product id to decide if the parallel bms service needs to start.
-		VeQItem *item = var->itemGetOrCreate("ProductId");
-		item->getValueAndChanges(this, SLOT(onBatteryProductIdChanged(QVariant)));
-	}
+	if (!mGeneratorStarterConditions.contains(service->getName()))
+		mGeneratorStarterConditions << service->getName();
+	manageGeneratorStartStop();
 }
 
-void Application::onGensetStateChanged(VeQItem::State state)
+void Application::onGensetLost(VenusService *service)
 {
-	VeQItem *item = static_cast<VeQItem *>(sender());
-	if (state == VeQItem::State::Synchronized)
-		mGeneratorStarterConditions << item->id();
-	else
-		mGeneratorStarterConditions.removeAll(item->id());
+	mGeneratorStarterConditions.removeAll(service->getName());
 	manageGeneratorStartStop();
 }
 
+// Need to look at the product id to decide if the parallel bms service needs to start.
+void Application::onBatteryFound(VenusService *service)
+{
+	service->item("ProductId")->getValueAndChanges(this, SLOT(onBatteryProductIdChanged(QVariant)));
+}
+
+void Application::onBatteryLost(VenusService *service)
+{
+	service->item("ProductId")->disconnect(this);
+	mParallelBmsConditions.removeAll(service->getName());
+	manageParallelBms();
+}
+
 void Application::onBatteryProductIdChanged(QVariant var)
 {
 	VeQItem *item = static_cast<VeQItem *>(sender());
@@ -429,21 +458,10 @@ void Application::manageParallelBms()
 		mParallelBmsStarter->stop();
 }
 
-void Application::initDaemonStartupConditions(VeQItem *service)
-{
-	if (service->getState() == VeQItem::State::Synchronized) {
-		if (service->id().startsWith("com.victronenergy.genset") || service->id().startsWith("com.victronenergy.dcgenset")) {
-			connect(service, SIGNAL(stateChanged(VeQItem::State)), SLOT(onGensetStateChanged(VeQItem::State)));
-			mGeneratorStarterConditions << service->id();
-		} else if (service->id().startsWith("com.victronenergy.battery")) {
-			VeQItem *item = service->itemGetOrCreate("ProductId");
-			item->getValueAndChanges(this, SLOT(onBatteryProductIdChanged(QVariant)));
-		}
-	}
-}
-
 void Application::manageDaemontoolsServices()
 {
+	StartupPhase phase("ManageDaemontoolsServices");
+
 	mOnScreenGuiv2Supported = QFile("/opt/victronenergy/gui-v2/venus-gui-v2").exists() && QFile("/dev/fb0").exists();
 	mService->itemGetOrCreateAndProduce("Gui/OnScreenGuiv2Supported", mOnScreenGuiv2Supported);
 
@@ -462,19 +480,16 @@ void Application::manageDaemontoolsServices()
 	item = mSettings->root()->itemGetOrCreate("Settings/Relay/Function");
 	item->getValueAndChanges(this, SLOT(onRelaySettingChanged(QVariant)));
 
-	VeQItem::Children const children = mServices->itemChildren();
-	for (VeQItem *child: children)
-		initDaemonStartupConditions(child);
-
-	connect(mServices, SIGNAL(childAdded(VeQItem*)), SLOT(onServiceAdded(VeQItem*)));
+	mVenusServices->subscribe(VenusServiceType::GENSET, this, "onGensetFound", "onGensetLost");
+	mVenusServices->subscribe(VenusServiceType::DCGENSET, this, "onGensetFound", "onGensetLost");
+	mVenusServices->subscribe(VenusServiceType::BATTERY, this, "onBatteryFound", "onBatteryLost");
 	manageGeneratorStartStop();
 
 	new DaemonToolsService(mSettings, "/service/dbus-ble-sensors", "Settings/Services/BleSensors", this);
 
 	new DaemonToolsService(mSettings, "/service/dbus-pump", "Settings/Relay/Function", 3, this);
 
-	new DaemonToolsService(mSettings, "/service/dbus-modbustcp", "Settings/Services/Modbus",
-						   this, QStringList() << "-s" << "dbus-modbustcp");
+	new TemplatedService(mSettings, "dbus-modbustcp", "Settings/Services/Modbus", this);
 
 	// Temperature relay
 	QList<QString> tempSensorRelayList = QList<QString>() << "Settings/Relay/Function" << "Settings/Relay/1/Function";
@@ -496,8 +511,7 @@ void Application::manageDaemontoolsServices()
 							   mSettings->root()->itemGetOrCreate("Settings/Services/SignalK"));
 	}
 
-	new DaemonToolsService(mSettings, "/service/vesmart-server", "Settings/Services/Bluetooth",
-						   this, QStringList() << "-s" << "vesmart-server");
+	new TemplatedService(mSettings, "vesmart-server", "Settings/Services/Bluetooth", this);
 
 	item = mSettings->root()->itemGetOrCreate("Settings/Vebus/AllowMk3Fw212Update");
 	item->getValueAndChanges(this, SLOT(onMk3UpdateAllowedChanged(QVariant)));
@@ -505,8 +519,7 @@ void Application::manageDaemontoolsServices()
 	if (templateExists("hostapd")) {
 		VeQItemProxy::addProxy(mService->itemGetOrCreate("Services/AccessPoint"), "Enabled",
 							   mSettings->root()->itemGetOrCreate("Settings/Services/AccessPoint"));
-		new DaemonToolsService(mSettings, "/service/hostapd", "Settings/Services/AccessPoint",
-							   this, QStringList() << "-s" << "hostapd");
+		new TemplatedService(mSettings, "hostapd", "Settings/Services/AccessPoint", this);
 	}
 
 	/*
@@ -519,8 +532,7 @@ void Application::manageDaemontoolsServices()
 	}
 
 	// CAN-bus debugging over tcp/ip
-	new DaemonToolsService(mSettings, "/service/socketcand", "Settings/Services/Socketcand",
-						   this, QStringList() << "-s" << "socketcand");
+	new TemplatedService(mSettings, "socketcand", "Settings/Services/Socketcand", this);
 
 	// An optionally service, which can be installed by e.g. a pendrive.
 	if (QDir("/data/evcc/service/").exists()) {
@@ -545,10 +557,12 @@ void Application::init()
 	enum Mk3Update mk3update = !installerVersion.isEmpty() && installerVersion >= "202210050000" ? NOT_APPLICABLE : DISALLOWED;
 
 	qDebug() << "Creating settings";
+	StartupTimeline::instance()->begin("AddSettings");
 	if (!mSettings->addSettings(SettingsInfo(mk3update))) {
 		qCritical() << "Creating settings failed";
 		::exit(EXIT_FAILURE);
 	}
+	StartupTimeline::instance()->end("AddSettings");
 
 	// Load the correct translation file first of all. Note, the add settings call above
 	// already obtained the selected language, hence this directly continues in the slot.
@@ -577,6 +591,8 @@ void Application::onLanguageChanged(QVariant var)
 
 void Application::loadTranslation()
 {
+	StartupPhase phase("LoadTranslation");
+
 	// Remove translation to get original english texts
 	if (mLanguage == "en") {
 		qApp->removeTranslator(&mTranslator);
@@ -601,22 +617,79 @@ void Application::createItemsForFlashmq()
 void Application::start()
 {
 	// The items exported to the dbus..
-	VeQItemProducer *toDbus = new VeQItemProducer(VeQItems::getRoot(), "to-dbus", this);
-	mService = toDbus->services()->itemGetOrCreate("com.victronenergy.platform", false);
+	mToDbus = new VeQItemProducer(VeQItems::getRoot(), "to-dbus", this);
+	mService = mToDbus->services()->itemGetOrCreate("com.victronenergy.platform", false);
 
 	mService->itemGetOrCreateAndProduce("ProductName", "Venus");
+	StartupTimeline::instance()->publish(mService);
+	MachineFeatures::instance()->publish(mService);
+	ProcessExecutor::instance()->publish(mService);
 
+	// The alarm handling is armed first, so the alarm relay and buzzer don't wait
+	// on unrelated and possibly slow stages.
+	mStartup = new StartupStages(mService, this);
+	mStartup->add("alarms", this, "startAlarms");
+	mStartup->add("publish", this, "startPublishing", QStringList() << "alarms");
+	mStartup->add("services", this, "startServices", QStringList() << "alarms");
+	mStartup->add("canbus", this, "startCanBus", QStringList() << "publish");
+	mStartup->add("device", this, "startDevice", QStringList() << "publish");
+	mStartup->add("uniqueId", this, "startUniqueId", QStringList() << "publish", true);
+	mStartup->add("updater", this, "startUpdater", QStringList() << "publish");
+	mStartup->add("network", this, "startNetwork", QStringList() << "publish");
+	connect(mStartup, SIGNAL(finished()), SLOT(onStartupFinished()));
+	mStartup->start();
+}
+
+void Application::onStartupFinished()
+{
+	StartupTimeline::instance()->writeTrace();
+}
+
+void Application::startAlarms()
+{
+	// Notifications
+	new AlarmStats(mService, this);
+	mNotifications = new Notifications(mService, this);
+	mSettings->root()->itemGetOrCreate("Settings/Alarm/Debounce")->getValueAndChanges(mNotifications, SLOT(setDebounce(QVariant)));
+	mSettings->root()->itemGetOrCreate("Settings/Alarm/FlapWindow")->getValueAndChanges(mNotifications, SLOT(setFlapWindow(QVariant)));
+	mVenusServices = new VenusServices(mServices, this);
+	mVenusServices->keep("com.victronenergy.settings");
+	mVenusServices->keep("com.victronenergy.system");
+	mSettings->root()->itemGetOrCreate("Settings/Alarm/ServiceGracePeriod")->getValueAndChanges(mVenusServices, SLOT(setGracePeriod(QVariant)));
+	mAlarmBusitems = new AlarmBusitems(mVenusServices, mNotifications);
+
+	// Handle buzer and relay alarms
+	mAudibleAlarm = mSettings->root()->itemGetOrCreate("Settings/Alarm/Audible");
+	mAlarm = mService->itemGetOrCreate("/Notifications/Alarm");
+	mBuzzer = new Buzzer("dbus/com.victronenergy.system/Buzzer/State");
+	mAlarm->getValueAndChanges(this, SLOT(onAlarmChanged(QVariant)));
+	mAudibleAlarm->getValueAndChanges(this, SLOT(onAlarmChanged(QVariant)));
+
+	mRelay = new Relay("dbus/com.victronenergy.system/Relay/0/State", mNotifications, this);
+	mSettings->root()->itemGetOrCreate("Settings/Alarm/RealtimePriority")->getValueAndChanges(this, SLOT(onAlarmPriorityChanged(QVariant)));
+
+	// Scan for dbus services
+	StartupTimeline::instance()->begin("InitialScan");
+	mVenusServices->initialScan();
+	StartupTimeline::instance()->end("InitialScan");
+}
+
+void Application::startPublishing()
+{
+	// Export the service to the dbus, the later stages add their items when ready.
+	VeQItemExportedDbusServices *publisher = new VeQItemExportedDbusServices(mToDbus->services(), this);
+	StartupPhase phase("Publish");
+	mService->produceValue(QString());
+	publisher->open(VeDbusConnection::getDBusAddress());
+}
+
+void Application::startServices()
+{
 	manageDaemontoolsServices();
 
 	createItemsForFlashmq();
 
-	mCanInterfaceMonitor = new CanInterfaceMonitor(mSettings, mService, this);
-	connect(mCanInterfaceMonitor, SIGNAL(interfacesChanged()), SLOT(onCanInterfacesChanged()));
-	mCanInterfaceMonitor->enumerate();
-
 	mDisplayController = new DisplayController(mSettings, this);
-
-	mUpdater = new Updater(mService, this);
 	mLedController = new LedController(this);
 
 	VeQItem *ledEnableSetting = mSettings->root()->itemGetOrCreate("Settings/LEDs/Enable");
@@ -630,19 +703,6 @@ void Application::start()
 	if (accessPointSetting)
 		accessPointSetting->getValueAndChanges(mLedController, SLOT(dbusSettingChanged()));
 
-	// Network controller
-	mNetworkController = new NetworkController(mService, this);
-
-	mService->itemGetOrCreate("Device")->itemAddChild("Reboot", new VeQItemReboot());
-	mService->itemGetOrCreate("Device")->itemAddChild("Time", new VeQItemTime());
-
-	QProcess *proc = Application::spawn("get-unique-id");
-	proc->waitForFinished();
-	mService->itemGetOrCreateAndProduce("Device/UniqueId", QString(proc->readAllStandardOutput().trimmed()));
-
-	int error = dataPartionError() ? 1 : 0;
-	mService->itemGetOrCreateAndProduce("Device/DataPartitionError", error);
-
 	bool evccInstalled = QDir("/data/evcc/service/").exists();
 	mService->itemGetOrCreateAndProduce("Services/Evcc/Installed", evccInstalled);
 
@@ -650,29 +710,70 @@ void Application::start()
 	VeQItem *demoModeSetting = mSettings->root()->itemGetOrCreate("Settings/Gui/DemoMode");
 	demoModeSetting->getValueAndChanges(this, SLOT(onDemoSettingChanged(QVariant)));
 
-	// Notifications
-	mNotifications = new Notifications(mService, this);
-	mVenusServices = new VenusServices(mServices, this);
-	mAlarmBusitems = new AlarmBusitems(mVenusServices, mNotifications);
-
 	new SecurityProfiles(mService, mSettings, mVenusServices, this);
+}
 
-	// Handle buzer and relay alarms
-	mAudibleAlarm = mSettings->root()->itemGetOrCreate("Settings/Alarm/Audible");
-	mAlarm = mService->itemGetOrCreate("/Notifications/Alarm");
-	mBuzzer = new Buzzer("dbus/com.victronenergy.system/Buzzer/State");
-	mAlarm->getValueAndChanges(this, SLOT(onAlarmChanged(QVariant)));
-	mAudibleAlarm->getValueAndChanges(this, SLOT(onAlarmChanged(QVariant)));
+void Application::startCanBus()
+{
+	mCanInterfaceMonitor = new CanInterfaceMonitor(mSettings, mService, this);
+	connect(mCanInterfaceMonitor, SIGNAL(interfacesChanged()), SLOT(onCanInterfacesChanged()));
+	StartupTimeline::instance()->begin("CanEnumerate");
+	mCanInterfaceMonitor->enumerate();
+	StartupTimeline::instance()->end("CanEnumerate");
+}
 
-	mRelay = new Relay("dbus/com.victronenergy.system/Relay/0/State", mNotifications, this);
+void Application::startDevice()
+{
+	mService->itemGetOrCreate("Device")->itemAddChild("Reboot", new VeQItemReboot());
+	mService->itemGetOrCreate("Device")->itemAddChild("Time", new VeQItemTime());
 
-	// Scan for dbus services
-	mVenusServices->initialScan();
+	int error = dataPartionError() ? 1 : 0;
+	mService->itemGetOrCreateAndProduce("Device/DataPartitionError", error);
+}
 
-	// With everything ready, do export the service to the dbus
-	VeQItemExportedDbusServices *publisher = new VeQItemExportedDbusServices(toDbus->services(), this);
-	mService->produceValue(QString());
-	publisher->open(VeDbusConnection::getDBusAddress());
+/*
+ * Not spawned, since the handlers must be connected before starting: failing to start
+ * can be reported from within start() and isn't followed by finished. The stage is done
+ * either way, without an id if get-unique-id can't be run.
+ */
+void Application::startUniqueId()
+{
+	QProcess *proc = new QProcess();
+	connect(proc, SIGNAL(finished(int)), SLOT(onUniqueIdObtained()));
+	connect(proc, SIGNAL(errorOccurred(QProcess::ProcessError)), SLOT(onUniqueIdError(QProcess::ProcessError)));
+	proc->start("get-unique-id", QStringList());
+}
+
+void Application::onUniqueIdObtained()
+{
+	QProcess *proc = static_cast<QProcess *>(sender());
+	mService->itemGetOrCreateAndProduce("Device/UniqueId", QString(proc->readAllStandardOutput().trimmed()));
+	mStartup->done("uniqueId");
+	proc->deleteLater();
+}
+
+void Application::onUniqueIdError(QProcess::ProcessError error)
+{
+	// A crash also results in finished, only failing to start doesn't.
+	if (error != QProcess::FailedToStart)
+		return;
+
+	QProcess *proc = static_cast<QProcess *>(sender());
+	qWarning() << "[UniqueId] failed to start get-unique-id:" << proc->errorString();
+	mService->itemGetOrCreateAndProduce("Device/UniqueId", QVariant());
+	mStartup->done("uniqueId");
+	proc->deleteLater();
+}
+
+void Application::startUpdater()
+{
+	mUpdater = new Updater(mService, this);
+}
+
+void Application::startNetwork()
+{
+	StartupPhase phase("NetworkController");
+	mNetworkController = new NetworkController(mService, this);
 }
 
 QProcess *Application::spawn(QString const &cmd, const QStringList &args)
@@ -683,12 +784,9 @@ QProcess *Application::spawn(QString const &cmd, const QStringList &args)
 	return proc;
 }
 
-int Application::run(QString const &cmd, const QStringList &args)
+ProcessJob *Application::run(QString const &cmd, const QStringList &args)
 {
-	QProcess proc;
-	proc.start(cmd, args);
-	proc.waitForFinished();
-	return proc.exitCode();
+	return ProcessExecutor::instance()->run(cmd, args);
 }
 
 bool Application::silenceBuzzer()
@@ -715,6 +813,32 @@ void Application::onAlarmChanged(QVariant var)
 	}
 }
 
+/*
+ * The alarms, notifications, relay and buzzer are handled by the main thread, since the
+ * items and the D-Bus connection live there, blocking work is done by other threads.
+ * Optionally it runs with a realtime priority, so an alarm isn't delayed by the rest of
+ * the system either. Spawned processes don't inherit it.
+ */
+void Application::onAlarmPriorityChanged(QVariant var)
+{
+	if (!var.isValid())
+		return;
+
+	struct sched_param param = {};
+	int priority = var.toInt();
+	int policy = SCHED_OTHER;
+
+	if (priority > 0) {
+		param.sched_priority = qBound(sched_get_priority_min(SCHED_FIFO), priority, sched_get_priority_max(SCHED_FIFO));
+		policy = SCHED_FIFO;
+	}
+
+	if (sched_setscheduler(0, policy | SCHED_RESET_ON_FORK, &param) != 0)
+		qWarning() << "[Alarm] setting the priority to" << priority << "failed:" << strerror(errno);
+	else
+		qDebug() << "[Alarm] realtime priority" << priority;
+}
+
 void Application::onEvccSettingChanged(QVariant var)
 {
 	if (!var.isValid())
@@ -723,37 +847,23 @@ void Application::onEvccSettingChanged(QVariant var)
 	if (var.toBool()) {
 		qDebug() << "[Service] Enabling evcc";
 		QFile::link("/data/evcc/service/", "/service/evcc");
-		system("svc -u /service/evcc");
+		SuperviseControl::send("/service/evcc", "u");
 	} else {
 		if (QDir("/service/evcc").exists()) {
 			qDebug() << "[Service] Removing evcc";
-			system("svc -d /service/evcc");
+			SuperviseControl::send("/service/evcc", "d");
 			QFile::remove("/service/evcc");
 		}
 	}
 }
 
-bool Application::setRootPassword(QString password)
+// The exit code of chpasswd is passed to the finished signal of the returned job.
+ProcessJob *Application::setRootPassword(QString password)
 {
-	QProcess process;
-	process.start(venusDir.filePath("swupdate-scripts/resize2fs.sh"));
-	process.waitForFinished();
-
-	process.start("/usr/sbin/chpasswd");
-	process.waitForStarted();
-
-	QString line("root:" + password);
-	process.write(line.toLocal8Bit());
-	process.closeWriteChannel();
-	process.waitForFinished();
-
-	if (process.exitCode() == 0) {
-		qWarning() << "Root password changed";
-		return true;
-	}
-
-	qCritical() << "Changing password failed";
-	return false;
+	ProcessJob *job = ProcessExecutor::instance()->createJob();
+	job->addStep(venusDir.filePath("swupdate-scripts/resize2fs.sh"));
+	job->addStep("/usr/sbin/chpasswd", QStringList(), QString("root:" + password).toLocal8Bit());
+	return job;
 }
 
 // After e.g. a password change at make sure persistent logins are
@@ -1,4 +1,5 @@
 #include <QCoreApplication>
+#include <QThread>
 #include <QTranslator>
 
 #include <veutil/qt/ve_qitems_dbus.hpp>
@@ -9,7 +10,9 @@
 #include "display_controller.hpp"
 #include "led_controller.hpp"
 #include "notifications.hpp"
+#include "process_executor.hpp"
 #include "relay.hpp"
+#include "startup.hpp"
 #include "network_controller.h"
 #include "updater.hpp"
 #include "venus_services.hpp"
@@ -33,16 +36,35 @@ private slots:
 	void doReboot();
 };
 
+// Waits till node-red is down and removes its data. Runs in its own thread, since
+// removing e.g. the npm cache can take minutes and must not delay the alarm relay.
+class NodeRedCleaner : public QObject {
+	Q_OBJECT
+
+public slots:
+	void clean(QString const &serviceDir);
+
+signals:
+	void cleaned();
+};
+
 class VeQItemNodeRedReset : public VeQItemAction {
 	Q_OBJECT
 
 public:
 	VeQItemNodeRedReset(DaemonToolsService *nodeRed, VeQItem *nodeRedMode);
+	virtual ~VeQItemNodeRedReset();
 	int setValue(const QVariant &value) override;
 
+private slots:
+	void onCleaned();
+
 private:
 	DaemonToolsService *mNodeRed;
 	VeQItem *mNodeRedMode;
+	QThread mThread;
+	NodeRedCleaner *mCleaner;
+	bool mBusy = false;
 };
 
 class Application : public QCoreApplication
@@ -53,8 +75,8 @@ public:
 	Application(int &argc, char **argv);
 
 	static QProcess *spawn(const QString &cmd, QStringList const &args = QStringList());
-	static int run(QString const &cmd, const QStringList &args = QStringList());
-	static bool setRootPassword(QString password);
+	static ProcessJob *run(QString const &cmd, const QStringList &args = QStringList());
+	static ProcessJob *setRootPassword(QString password);
 	static void invalidateAuthenticatedSessions();
 	bool silenceBuzzer();
 
@@ -70,6 +92,7 @@ signals:
 
 protected slots:
 	void onAlarmChanged(QVariant var);
+	void onAlarmPriorityChanged(QVariant var);
 	void onCanInterfacesChanged();
 	void onDemoSettingChanged(QVariant var);
 	void onEvccSettingChanged(QVariant var);
@@ -79,15 +102,29 @@ protected slots:
 	void onMk3UpdateAllowedChanged(QVariant var);
 	void onRunningGuiVersionObtained(QVariant var);
 	void onRelaySettingChanged(QVariant var);
-	void onServiceAdded(VeQItem *var);
-	void onGensetStateChanged(VeQItem::State state);
+	void onGensetFound(VenusService *service);
+	void onGensetLost(VenusService *service);
+	void onBatteryFound(VenusService *service);
+	void onBatteryLost(VenusService *service);
 	void onBatteryProductIdChanged(QVariant var);
+	void onUniqueIdObtained();
+	void onUniqueIdError(QProcess::ProcessError error);
+	void onStartupFinished();
+
+	// startup stages, see start()
+	void startAlarms();
+	void startPublishing();
+	void startServices();
+	void startCanBus();
+	void startDevice();
+	void startUniqueId();
+	void startUpdater();
+	void startNetwork();
 
 private:
 	void createItemsForFlashmq();
 	void manageDaemontoolsServices();
 	void loadTranslation();
-	void initDaemonStartupConditions(VeQItem *service);
 	void manageGeneratorStartStop();
 	void manageParallelBms();
 	void init();
@@ -107,6 +144,8 @@ private:
 	QTranslator mTranslator;
 
 	VeQItem *mService;
+	VeQItemProducer *mToDbus;
+	StartupStages *mStartup;
 	VenusServices *mVenusServices;
 
 	Notifications *mNotifications;
@@ -1,5 +1,6 @@
 #include <veutil/qt/ve_qitem.hpp>
 
+#include "alarm_stats.hpp"
 #include "buzzer.hpp"
 
 Buzzer::Buzzer(const QString &buzzerPath, QObject *parent) :
@@ -48,4 +49,6 @@ void Buzzer::setBuzzer(bool on)
 	qDebug() << "Buzzer::setBuzzer:" << on;
 	mBuzzerToggle = on;
 	mBuzzerItem->setValue(on);
+	if (on && AlarmStats::instance())
+		AlarmStats::instance()->buzzerSwitched();
 }
@@ -0,0 +1,123 @@
+#include <QDebug>
+#include <QTimer>
+
+#include "firewall_manager.hpp"
+#include "process_executor.hpp"
+
+FirewallManager::FirewallManager(VeQItem *parentItem, QObject *parent) :
+	QObject(parent)
+{
+	mItem = parentItem->itemGetOrCreate("Firewall");
+	mRetryTimer.setSingleShot(true);
+	connect(&mRetryTimer, SIGNAL(timeout()), SLOT(apply()));
+	updateItems();
+}
+
+// Note: the state of a rule is unknown at startup, so the first request is always applied.
+void FirewallManager::setAllowed(int port, bool allowed, QString const &protocol)
+{
+	QString key = protocol + "/" + QString::number(port);
+	QMap<QString, Rule>::iterator it = mRules.find(key);
+
+	if (it == mRules.end()) {
+		Rule rule;
+		rule.protocol = protocol;
+		rule.port = port;
+		rule.applied = RULE_UNKNOWN;
+		rule.applying = RULE_UNKNOWN;
+		it = mRules.insert(key, rule);
+	}
+
+	it->desired = allowed ? RULE_ALLOWED : RULE_DENIED;
+	scheduleApply();
+}
+
+void FirewallManager::scheduleApply()
+{
+	if (mScheduled || mBusy)
+		return;
+
+	mScheduled = true;
+	QTimer::singleShot(0, this, SLOT(apply()));
+}
+
+void FirewallManager::apply()
+{
+	mScheduled = false;
+	if (mBusy)
+		return;
+	mRetryTimer.stop();
+
+	ProcessJob *job = nullptr;
+	for (Rule &rule: mRules) {
+		if (rule.desired == rule.applied)
+			continue;
+
+		if (!job) {
+			job = ProcessExecutor::instance()->createJob();
+			job->setStopOnError(true);
+		}
+
+		QString action = rule.desired == RULE_ALLOWED ? "allow" : "deny";
+		qWarning() << "[Firewall]" << action << rule.protocol << rule.port;
+		job->addStep("firewall", QStringList() << action << rule.protocol << QString::number(rule.port));
+		rule.applying = rule.desired;
+	}
+
+	if (!job)
+		return;
+
+	mBusy = true;
+	connect(job, SIGNAL(finished(int)), SLOT(onApplied(int)));
+}
+
+void FirewallManager::onApplied(int exitCode)
+{
+	mBusy = false;
+
+	for (Rule &rule: mRules) {
+		if (rule.applying == RULE_UNKNOWN)
+			continue;
+
+		// If it failed it is unknown which rules were applied, so they are retried.
+		rule.applied = exitCode == 0 ? rule.applying : RULE_UNKNOWN;
+		rule.applying = RULE_UNKNOWN;
+	}
+
+	updateItems();
+
+	bool pending = false;
+	for (Rule const &rule: mRules) {
+		if (rule.desired != rule.applied) {
+			pending = true;
+			break;
+		}
+	}
+
+	if (exitCode == 0) {
+		mRetryMs = minRetryMs;
+		// Changes made while this batch was being applied
+		if (pending)
+			scheduleApply();
+		return;
+	}
+
+	// The rules which failed, and the changes made meanwhile, must not wait for an
+	// unrelated change, e.g. a port which should be closed again.
+	qCritical() << "[Firewall] applying the rules failed" << exitCode << "retrying in" << mRetryMs << "ms";
+	if (pending) {
+		mRetryTimer.start(mRetryMs);
+		mRetryMs = qMin(mRetryMs * 2, maxRetryMs);
+	}
+}
+
+void FirewallManager::updateItems()
+{
+	QStringList allowed;
+	for (Rule const &rule: mRules) {
+		if (rule.applied == RULE_ALLOWED)
+			allowed.append(rule.protocol + "/" + QString::number(rule.port));
+	}
+
+	mItem->itemGetOrCreateAndProduce("AllowedPorts", allowed.join(","));
+}
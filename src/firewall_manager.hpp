@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QMap>
+#include <QObject>
+#include <QTimer>
+
+#include <veutil/qt/ve_qitem.hpp>
+
+// Keeps the ports which should be open in the firewall. Changes made within the
+// same event loop iteration are collected, diffed against the applied rules and
+// applied as a single job off the main loop. The applied rules are exported in
+// Firewall/AllowedPorts, e.g. "tcp/1883,tcp/8883". Rules which failed to apply
+// are retried, with an increasing interval.
+class FirewallManager : public QObject
+{
+	Q_OBJECT
+
+public:
+	FirewallManager(VeQItem *parentItem, QObject *parent = 0);
+
+	void setAllowed(int port, bool allowed, QString const &protocol = "tcp");
+
+private slots:
+	void apply();
+	void onApplied(int exitCode);
+
+private:
+	enum RuleState {
+		RULE_UNKNOWN,
+		RULE_DENIED,
+		RULE_ALLOWED
+	};
+
+	struct Rule {
+		QString protocol;
+		int port;
+		RuleState desired;
+		RuleState applied;
+		RuleState applying;
+	};
+
+	static int const minRetryMs = 1000;
+	static int const maxRetryMs = 60000;
+
+	void scheduleApply();
+	void updateItems();
+
+	QMap<QString, Rule> mRules;
+	QTimer mRetryTimer;
+	int mRetryMs = minRetryMs;
+	bool mScheduled = false;
+	bool mBusy = false;
+	VeQItem *mItem;
+};
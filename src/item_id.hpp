@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QString>
+
+// Item ids are part of the D-Bus path, which only allows [A-Za-z0-9_]. Service names
+// contain dots and interface and feature names dashes, these become underscores.
+inline QString itemId(QString const &name)
+{
+	QString id = name;
+	for (QChar &c: id) {
+		if (!c.isLetterOrNumber() || c.unicode() > 127)
+			c = '_';
+	}
+	return id;
+}
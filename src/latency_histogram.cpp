@@ -0,0 +1,109 @@
+#include <algorithm>
+
+#include "latency_histogram.hpp"
+
+int LatencyHistogram::bucket(qint64 us)
+{
+	int bucket = 0;
+	while (bucket < buckets - 1 && (qint64(1) << bucket) < us)
+		bucket++;
+	return bucket;
+}
+
+qint64 LatencyHistogram::percentile(quint64 const *counts, quint64 count, qint64 max, int percent)
+{
+	if (count == 0)
+		return 0;
+
+	quint64 rank = (count * percent + 99) / 100;
+	quint64 n = 0;
+	for (int bucket = 0; bucket < buckets; bucket++) {
+		n += counts[bucket];
+		if (n >= rank)
+			return qMin(qint64(1) << bucket, max);
+	}
+
+	return max;
+}
+
+void LatencyHistogram::produce(VeQItem *item, quint64 const *counts, quint64 count, qint64 max)
+{
+	item->itemGetOrCreateAndProduce("Count", count);
+	item->itemGetOrCreateAndProduce("P50", percentile(counts, count, max, 50));
+	item->itemGetOrCreateAndProduce("P95", percentile(counts, count, max, 95));
+	item->itemGetOrCreateAndProduce("P99", percentile(counts, count, max, 99));
+	item->itemGetOrCreateAndProduce("Max", max);
+}
+
+void LatencyHistogram::add(qint64 us)
+{
+	mBuckets[bucket(us)]++;
+	mCount++;
+	if (us > mMax)
+		mMax = us;
+	mChanged = true;
+}
+
+qint64 LatencyHistogram::percentile(int percent) const
+{
+	return percentile(mBuckets, mCount, mMax, percent);
+}
+
+void LatencyHistogram::publish()
+{
+	if (!mChanged)
+		return;
+
+	mChanged = false;
+	produce(mItem, mBuckets, mCount, mMax);
+}
+
+WindowedLatencyHistogram::WindowedLatencyHistogram(VeQItem *item, int windowMinutes) :
+	mItem(item),
+	mWindowMs(windowMinutes * 60000LL)
+{
+	mWindowTimer.start();
+}
+
+// Starts a new window when the current one is over. The previous one is dropped then,
+// both when nothing was added for more than two windows.
+void WindowedLatencyHistogram::expire()
+{
+	qint64 elapsed = mWindowTimer.elapsed();
+	if (elapsed < mWindowMs)
+		return;
+
+	int windows = elapsed >= 2 * mWindowMs ? 2 : 1;
+	for (int n = 0; n < windows; n++) {
+		mCurrent ^= 1;
+		std::fill(mBuckets[mCurrent], mBuckets[mCurrent] + LatencyHistogram::buckets, 0);
+		mCount[mCurrent] = 0;
+		mMax[mCurrent] = 0;
+	}
+	mWindowTimer.restart();
+	mChanged = true;
+}
+
+void WindowedLatencyHistogram::add(qint64 us)
+{
+	expire();
+	mBuckets[mCurrent][LatencyHistogram::bucket(us)]++;
+	mCount[mCurrent]++;
+	if (us > mMax[mCurrent])
+		mMax[mCurrent] = us;
+	mChanged = true;
+}
+
+void WindowedLatencyHistogram::publish()
+{
+	expire();
+	if (!mChanged)
+		return;
+
+	quint64 counts[LatencyHistogram::buckets];
+	for (int n = 0; n < LatencyHistogram::buckets; n++)
+		counts[n] = mBuckets[0][n] + mBuckets[1][n];
+
+	mChanged = false;
+	LatencyHistogram::produce(mItem, counts, mCount[0] + mCount[1], qMax(mMax[0], mMax[1]));
+}
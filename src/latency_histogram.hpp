@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QtGlobal>
+
+#include <veutil/qt/ve_qitem.hpp>
+
+// A histogram of latencies in us with power of two buckets, so adding a sample is
+// cheap and the memory is fixed. The percentiles are the upper bound of the bucket
+// they fall in. Exported as Count, P50, P95, P99 and Max below the item.
+class LatencyHistogram
+{
+public:
+	static int const buckets = 32;
+
+	LatencyHistogram(VeQItem *item) : mItem(item) {}
+
+	void add(qint64 us);
+	qint64 percentile(int percent) const;
+	quint64 count() const { return mCount; }
+	qint64 max() const { return mMax; }
+
+	// Produces the items if samples were added since the last time.
+	void publish();
+
+	static int bucket(qint64 us);
+	static qint64 percentile(quint64 const *counts, quint64 count, qint64 max, int percent);
+	static void produce(VeQItem *item, quint64 const *counts, quint64 count, qint64 max);
+
+private:
+	VeQItem *mItem;
+	quint64 mBuckets[buckets] = {};
+	quint64 mCount = 0;
+	qint64 mMax = 0;
+	bool mChanged = true;
+};
+
+// The same, but only for the recent samples, so a regression shows up instead of being
+// averaged away by the samples since boot. There are two sets of buckets, the current and
+// the previous window, which alternate every window. The percentiles are those of both,
+// so of the last one to two windows.
+class WindowedLatencyHistogram
+{
+public:
+	WindowedLatencyHistogram(VeQItem *item, int windowMinutes = 10);
+
+	void add(qint64 us);
+	void publish();
+
+private:
+	void expire();
+
+	VeQItem *mItem;
+	qint64 mWindowMs;
+	QElapsedTimer mWindowTimer;
+	int mCurrent = 0;
+	quint64 mBuckets[2][LatencyHistogram::buckets] = {};
+	quint64 mCount[2] = {};
+	qint64 mMax[2] = {};
+	bool mChanged = true;
+};
@@ -0,0 +1,163 @@
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QRegularExpression>
+#include <QSocketNotifier>
+
+#include "item_id.hpp"
+#include "machine_features.hpp"
+
+// Features are single values or short lists, anything larger is not a feature.
+static const qint64 maxFeatureSize = 4096;
+
+MachineFeatures *MachineFeatures::instance()
+{
+	static MachineFeatures *features = new MachineFeatures("/etc/venus", qApp);
+	return features;
+}
+
+MachineFeatures::MachineFeatures(QString const &dir, QObject *parent) :
+	QObject(parent),
+	mDir(dir)
+{
+	mInotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (mInotifyFd >= 0 && inotify_add_watch(mInotifyFd, QFile::encodeName(mDir).constData(),
+			IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE) >= 0) {
+		mNotifier = new QSocketNotifier(mInotifyFd, QSocketNotifier::Read, this);
+		connect(mNotifier, SIGNAL(activated(int)), SLOT(onInotifyEvent()));
+	} else {
+		qWarning() << "[MachineFeatures] unable to watch" << mDir << ", changes are not picked up";
+	}
+
+	scan();
+}
+
+MachineFeatures::~MachineFeatures()
+{
+	if (mInotifyFd >= 0)
+		close(mInotifyFd);
+}
+
+// Features which are no longer there are removed as well, for a rescan after the
+// inotify queue overflowed.
+void MachineFeatures::scan()
+{
+	QSet<QString> removed;
+	for (QHash<QString, Feature>::const_iterator it = mFeatures.constBegin(); it != mFeatures.constEnd(); ++it)
+		removed.insert(it.key());
+
+	QDir dir(mDir);
+	QFileInfoList const entries = dir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
+	for (QFileInfo const &info: entries) {
+		reload(info.fileName());
+		removed.remove(info.fileName());
+	}
+
+	for (QString const &name: removed)
+		reload(name);
+}
+
+void MachineFeatures::reload(QString const &name)
+{
+	QFile file(mDir + "/" + name);
+
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text) || file.size() > maxFeatureSize) {
+		if (mFeatures.remove(name))
+			publishFeature(name);
+		return;
+	}
+
+	Feature feature;
+	while (!file.atEnd()) {
+		QString line = QString::fromUtf8(file.readLine()).trimmed();
+		if (line.isEmpty())
+			continue;
+		feature.lines.append(line);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+		feature.words.append(line.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts));
+#else
+		feature.words.append(line.split(QRegExp("\\s+"), QString::SkipEmptyParts));
+#endif
+	}
+
+	mFeatures.insert(name, feature);
+	publishFeature(name);
+}
+
+QStringList MachineFeatures::list(QString const &name, bool lines) const
+{
+	QHash<QString, Feature>::const_iterator it = mFeatures.constFind(name);
+	if (it == mFeatures.constEnd())
+		return QStringList();
+	return lines ? it->lines : it->words;
+}
+
+QString MachineFeatures::value(QString const &name) const
+{
+	QStringList const words = list(name);
+	return words.isEmpty() ? QString() : words.first();
+}
+
+bool MachineFeatures::templateExists(QString const &name)
+{
+	if (!mTemplatesScanned) {
+		QDir dir("/opt/victronenergy/service-templates/conf");
+		for (QString const &conf: dir.entryList(QStringList() << "*.conf", QDir::Files))
+			mTemplates.insert(conf.left(conf.length() - 5));
+		mTemplatesScanned = true;
+	}
+
+	return mTemplates.contains(name);
+}
+
+void MachineFeatures::onInotifyEvent()
+{
+	char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	QSet<QString> changed;
+	bool overflow = false;
+	ssize_t len;
+
+	while ((len = read(mInotifyFd, buf, sizeof(buf))) > 0) {
+		for (char *ptr = buf; ptr < buf + len; ) {
+			struct inotify_event const *event = reinterpret_cast<struct inotify_event const *>(ptr);
+			if (event->mask & IN_Q_OVERFLOW)
+				overflow = true;
+			else if (event->len)
+				changed.insert(QFile::decodeName(event->name));
+			ptr += sizeof(struct inotify_event) + event->len;
+		}
+	}
+
+	// Events were lost, so which files changed is unknown.
+	if (overflow) {
+		qWarning() << "[MachineFeatures] inotify queue overflow, rescanning" << mDir;
+		scan();
+		return;
+	}
+
+	for (QString const &name: changed)
+		reload(name);
+}
+
+void MachineFeatures::publish(VeQItem *parentItem)
+{
+	mItem = parentItem->itemGetOrCreate("MachineFeatures");
+	for (QString const &name: mFeatures.keys())
+		publishFeature(name);
+}
+
+void MachineFeatures::publishFeature(QString const &name)
+{
+	if (!mItem)
+		return;
+
+	QHash<QString, Feature>::const_iterator it = mFeatures.constFind(name);
+	if (it == mFeatures.constEnd())
+		mItem->itemGetOrCreateAndProduce(itemId(name), QVariant());
+	else
+		mItem->itemGetOrCreateAndProduce(itemId(name), it->lines.join("\n"));
+}
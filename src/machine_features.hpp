@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+
+#include <veutil/qt/ve_qitem.hpp>
+
+class QSocketNotifier;
+
+// The machine features in /etc/venus are small files describing the hardware. They
+// are read once with a single directory scan and kept parsed in memory. A single
+// inotify watch on the directory refreshes the entries when a file changes. The
+// service templates are on the readonly rootfs, so these are only scanned once.
+class MachineFeatures : public QObject
+{
+	Q_OBJECT
+
+public:
+	static MachineFeatures *instance();
+	~MachineFeatures();
+
+	bool contains(QString const &name) const { return mFeatures.contains(name); }
+	QStringList list(QString const &name, bool lines = false) const;
+	QString value(QString const &name) const;
+	bool templateExists(QString const &name);
+
+	void publish(VeQItem *parentItem);
+
+private slots:
+	void onInotifyEvent();
+
+private:
+	struct Feature {
+		QStringList words;
+		QStringList lines;
+	};
+
+	MachineFeatures(QString const &dir, QObject *parent = 0);
+	void scan();
+	void reload(QString const &name);
+	void publishFeature(QString const &name);
+
+	QString mDir;
+	QHash<QString, Feature> mFeatures;
+	QSet<QString> mTemplates;
+	bool mTemplatesScanned = false;
+	int mInotifyFd = -1;
+	QSocketNotifier *mNotifier = nullptr;
+	VeQItem *mItem = nullptr;
+};
@@ -1,10 +1,18 @@
 #include <iostream>
+#include <string.h>
 #include <src/application.hpp>
+#include <src/service_templates.hpp>
 
 static const char *version = "1.71";
 
 int main(int argc, char *argv[])
 {
+	// svectl is a thin wrapper around the service template engine.
+	if (argc > 1 && strcmp(argv[1], "--svectl") == 0) {
+		argv[1] = argv[0];
+		return ServiceTemplates::cli(argc - 1, argv + 1);
+	}
+
 	std::cout << "Version: " << version << std::endl;
 
 	Application app(argc, argv);
@@ -1,5 +1,25 @@
+#include <QMap>
+#include <QSet>
+
+#include "address_monitor.hpp"
+#include "item_id.hpp"
 #include "network_controller.h"
 #include "json.h"
+#include "publish_batch.hpp"
+
+// The last part of the service path, e.g. wifi_xxx_managed_psk, as a valid D-Bus path element.
+static QString serviceId(const QString &path)
+{
+	return itemId(path.mid(path.lastIndexOf('/') + 1));
+}
+
+// E.g. wifi -> Wifi, like the existing /Network/Wifi and /Network/Ethernet.
+static QString technologyId(const QString &technology)
+{
+	if (technology.isEmpty())
+		return technology;
+	return technology.at(0).toUpper() + technology.mid(1);
+}
 
 int VeQItemJson::setValue(const QVariant &value)
 {
@@ -31,7 +51,7 @@ int VeQItemScan::setValue(const QVariant &value)
 }
 
 NetworkController::NetworkController(VeQItem *parentItem, QObject *parent)
-	: QObject{parent}, mWifiService(nullptr), mEthernetService(nullptr)
+	: QObject{parent}, mWifiService(nullptr)
 {
 	mConnman = CmManager::instance(this);
 	VeQItemJson *parser = new VeQItemJson();
@@ -43,117 +63,274 @@ NetworkController::NetworkController(VeQItem *parentItem, QObject *parent)
 	VeQItem *ethernet = mItem->itemGetOrCreate("Ethernet");
 	ethernet->itemAddChild("LinkLocalIpAddress", new VeQItemQuantity());
 
+	// The link local address is kept up to date by the kernel notifications.
+	mAddresses = new AddressMonitor(mItem, this);
+	connect(mAddresses, SIGNAL(addressesChanged(QString)), this, SLOT(onAddressesChanged(QString)));
+	updateLinkLocal();
+
+	mFlushTimer.setSingleShot(true);
+	mFlushTimer.setInterval(flushInterval);
+	connect(&mFlushTimer, SIGNAL(timeout()), this, SLOT(flushServices()));
+
+	connect(mConnman, SIGNAL(ready()), this, SLOT(onConnmanReady()));
+	connect(mConnman, SIGNAL(serviceListChanged()), this, SLOT(onServiceListChanged()));
+	connect(mConnman, SIGNAL(serviceChanged(QString,QVariantMap)), this, SLOT(onServiceChanged(QString)));
+	connect(mConnman, SIGNAL(serviceRemoved(QString)), this, SLOT(onServiceRemoved(QString)));
+	connect(parser, SIGNAL(jsonParsed(QVariantMap)), this, SLOT(handleCommand(QVariantMap)));
+
+	// Connman is queried asynchronously, the services are added once it is ready, which is
+	// also the case again after connman restarted.
+	if (mConnman->isReady())
+		onConnmanReady();
+}
+
+void NetworkController::onConnmanReady()
+{
 	CmTechnology *tech = mConnman->getTechnology("wifi");
 	QStringList services;
 	if (tech && tech->powered()) {
-		VeQItem *wifi = mItem->itemGetOrCreate("Wifi");
-		wifi->itemAddChild("Scan", new VeQItemScan(mConnman));
-		wifi->itemAddChild("State", new VeQItemQuantity(-1, "", "Disconnected"));
-		wifi->itemAddChild("SignalStrength", new VeQItemQuantity());
+		if (!mWifiItemsCreated) {
+			VeQItem *wifi = mItem->itemGetOrCreate("Wifi");
+			wifi->itemAddChild("Scan", new VeQItemScan(mConnman));
+			wifi->itemAddChild("State", new VeQItemQuantity(-1, "", "Disconnected"));
+			wifi->itemAddChild("SignalStrength", new VeQItemQuantity());
+			mWifiItemsCreated = true;
+		}
 
 		services = mConnman->getServiceList("wifi");
 		for (auto &s: services) {
 			CmService *service = mConnman->getService(s);
 			if (service && service->favorite()) {
-				mWifiService = service;
-				connectServiceSignals(mWifiService);
-				updateWifiState();
+				setWifiService(service);
 				break;
 			}
 		}
 	}
 
-	services = mConnman->getServiceList("ethernet");
-	if (!services.empty()) {
-		mEthernetService = mConnman->getService(services[0]);
-		if (mEthernetService) {
-			connectServiceSignals(mEthernetService);
-			updateLinkLocal();
+	mListDirty = true;
+	flushServices();
+}
+
+// Changes of the ip configuration are not reported by the serviceChanged of the manager.
+void NetworkController::connectServiceSignals(CmService *service)
+{
+	connect(service, SIGNAL(ipv4Changed()), this, SLOT(onServicePropertiesChanged()), Qt::UniqueConnection);
+	connect(service, SIGNAL(ipv4ConfigChanged()), this, SLOT(onServicePropertiesChanged()), Qt::UniqueConnection);
+	connect(service, SIGNAL(nameserversChanged()), this, SLOT(onServicePropertiesChanged()), Qt::UniqueConnection);
+	connect(service, SIGNAL(nameserversConfigChanged()), this, SLOT(onServicePropertiesChanged()), Qt::UniqueConnection);
+}
+
+// Only the state and strength of the active wifi service are published.
+void NetworkController::setWifiService(CmService *service)
+{
+	if (mWifiService != service) {
+		if (mWifiService) {
+			QObject::disconnect(mWifiService, SIGNAL(stateChanged()), this, SLOT(updateWifiState()));
+			QObject::disconnect(mWifiService, SIGNAL(strengthChanged()), this, SLOT(updateWifiSignalStrength()));
+		}
+
+		mWifiService = service;
+
+		if (mWifiService) {
+			connect(mWifiService, SIGNAL(stateChanged()), this, SLOT(updateWifiState()), Qt::UniqueConnection);
+			connect(mWifiService, SIGNAL(strengthChanged()), this, SLOT(updateWifiSignalStrength()), Qt::UniqueConnection);
 		}
 	}
 
-	connect(mConnman, SIGNAL(serviceListChanged()), this, SLOT(buildServicesList()));
-	connect(mConnman, SIGNAL(serviceChanged(QString,QVariantMap)), this, SLOT(buildServicesList()));
-	connect(mConnman, SIGNAL(serviceAdded(QString)), this, SLOT(onServiceAdded(QString)));
-	connect(mConnman, SIGNAL(serviceRemoved(QString)), this, SLOT(onServiceRemoved(QString)));
-	connect(parser, SIGNAL(jsonParsed(QVariantMap)), this, SLOT(handleCommand(QVariantMap)));
+	updateWifiState();
+}
 
-	buildServicesList();
+void NetworkController::onServiceListChanged()
+{
+	mListDirty = true;
+	scheduleFlush();
 }
 
-void NetworkController::connectServiceSignals(CmService *service)
+void NetworkController::onServiceChanged(const QString &path)
 {
-	connect(service, SIGNAL(ipv4Changed()), this, SLOT(buildServicesList()));
-	connect(service, SIGNAL(ipv4ConfigChanged()), this, SLOT(buildServicesList()));
-	connect(service, SIGNAL(nameserversChanged()), this, SLOT(buildServicesList()));
-	connect(service, SIGNAL(nameserversConfigChanged()), this, SLOT(buildServicesList()));
-
-	if (service->type() == "wifi") {
-		connect(service, SIGNAL(stateChanged()), this, SLOT(updateWifiState()));
-		connect(service, SIGNAL(strengthChanged()), this, SLOT(updateWifiSignalStrength()));
-	} else {
-		connect(mEthernetService, SIGNAL(stateChanged()), this, SLOT(updateLinkLocal()));
-	}
+	auto it = mEntries.find(path);
+	if (it == mEntries.end())
+		mListDirty = true;
+	else
+		it.value().dirty = true;
+	scheduleFlush();
+}
+
+void NetworkController::onServicePropertiesChanged()
+{
+	CmService *service = qobject_cast<CmService *>(sender());
+	if (service)
+		onServiceChanged(service->path());
+}
+
+/*
+ * During a wifi scan connman reports the changes of every access point, often several per
+ * second. They are collected and published at most every flushInterval.
+ */
+void NetworkController::scheduleFlush()
+{
+	if (!mFlushTimer.isActive())
+		mFlushTimer.start();
 }
 
-void NetworkController::buildServicesList()
+// Adds the services which appeared and drops the ones which are gone.
+void NetworkController::syncServiceList(PublishBatch &batch)
 {
-	QVariantMap obj;
+	QSet<QString> present;
 
-	// Loop over technologies
 	QStringList technologies = mConnman->getTechnologyList();
 	bool hasBluetooth = technologies.contains("bluetooth");
-	mItem->itemGetOrCreateAndProduce("HasBluetoothSupport", hasBluetooth);
+	batch.produce(mItem, "HasBluetoothSupport", hasBluetooth);
 	technologies.removeAll("bluetooth");
 	technologies.removeAll("p2p");
+	mTechnologies = technologies;
 
 	for (auto &t: technologies) {
-		// Loop over services within technology
-		QStringList services = mConnman->getServiceList(t);
+		for (auto &s: mConnman->getServiceList(t)) {
+			present.insert(s);
+			if (mEntries.contains(s))
+				continue;
 
-		QVariantMap list;
-		for (auto &s: services) {
 			CmService *service = mConnman->getService(s);
-			if (service) {
-				QVariantMap ipv4 = service->ipv4Config()["Method"] == "dhcp" ? service->ipv4() : service->ipv4Config();
-				QStringList dns = service->nameservers();
-				QStringList security = service->security();
-				QVariantMap properties = service->properties();
-				QVariantMap ethernet = service->ethernet();
-
-				QVariantMap m;
-				m.insert("Service", s);
-				m.insert("State", properties["State"].toString());
-				if (properties.contains("Strength"))
-					m.insert("Strength", properties["Strength"].toUInt());
-				if (!security.empty())
-					m.insert("Secured", QString(security.contains("none") ? "no" : "yes"));
-				if (t == "wifi")
-					m.insert("Favorite", QString(service->favorite() ? "yes" : "no"));
-				m.insert("Address", ipv4["Address"].toString());
-				m.insert("Gateway", ipv4["Gateway"].toString());
-				m.insert("Method", ipv4["Method"].toString());
-				m.insert("Netmask", ipv4["Netmask"].toString());
-				m.insert("Mac", ethernet["Address"].toString());
-				m.insert("Nameservers", dns);
-
-				list.insert(properties["Name"].toString(), m);
-
-				// If there is a wifi service which is not the current service but has state == "ready",
-				// then set it as the active wifi service.
-				// This may happen when the current connection fails (for some reason) and
-				// connman connects to another favorite network automatically.
-				if ((t == "wifi") && (properties["State"] == "ready") && (mWifiService != service)) {
-					mWifiService = service;
-					connectServiceSignals(service);
-					updateWifiState();
-				}
-			}
+			if (!service)
+				continue;
+
+			ServiceEntry entry;
+			entry.technology = t;
+			entry.item = mItem->itemGetOrCreate(technologyId(t) + "/Services/" + serviceId(s));
+			mEntries.insert(s, entry);
+			connectServiceSignals(service);
 		}
-		obj.insert(t, list);
 	}
-	QByteArray data = QtJson::serialize(obj);
-	mItem->itemGetOrCreateAndProduce("Services", QString(data));
+
+	for (auto it = mEntries.begin(); it != mEntries.end();) {
+		if (present.contains(it.key()))
+			++it;
+		else
+			it = eraseEntry(it);
+	}
+}
+
+QHash<QString, NetworkController::ServiceEntry>::iterator NetworkController::eraseEntry(QHash<QString, ServiceEntry>::iterator it)
+{
+	if (it.value().item)
+		it.value().item->itemDelete();
+	return mEntries.erase(it);
+}
+
+/*
+ * Returns true if the entry changed, only then it is serialized again. The fields are also
+ * published as the items of the service, only the ones which changed, so a strength update
+ * of an access point doesn't require clients to fetch and parse all services again.
+ */
+bool NetworkController::updateEntry(const QString &path, ServiceEntry &entry, PublishBatch &batch)
+{
+	CmService *service = mConnman->getService(path);
+	if (!service)
+		return false;
+
+	QString const &t = entry.technology;
+	QVariantMap ipv4 = service->ipv4Config()["Method"] == "dhcp" ? service->ipv4() : service->ipv4Config();
+	QStringList dns = service->nameservers();
+	QStringList security = service->security();
+	QVariantMap properties = service->properties();
+	QVariantMap ethernet = service->ethernet();
+
+	QVariantMap m;
+	m.insert("Service", path);
+	m.insert("State", properties["State"].toString());
+	if (properties.contains("Strength"))
+		m.insert("Strength", properties["Strength"].toUInt());
+	if (!security.empty())
+		m.insert("Secured", QString(security.contains("none") ? "no" : "yes"));
+	if (t == "wifi")
+		m.insert("Favorite", QString(service->favorite() ? "yes" : "no"));
+	m.insert("Address", ipv4["Address"].toString());
+	m.insert("Gateway", ipv4["Gateway"].toString());
+	m.insert("Method", ipv4["Method"].toString());
+	m.insert("Netmask", ipv4["Netmask"].toString());
+	m.insert("Mac", ethernet["Address"].toString());
+	m.insert("Nameservers", dns);
+
+	// If there is a wifi service which is not the current service but has state == "ready",
+	// then set it as the active wifi service.
+	// This may happen when the current connection fails (for some reason) and
+	// connman connects to another favorite network automatically.
+	if ((t == "wifi") && (properties["State"] == "ready") && (mWifiService != service))
+		setWifiService(service);
+
+	QString name = properties["Name"].toString();
+	if (m == entry.fields && name == entry.name && !entry.json.isEmpty())
+		return false;
+
+	if (name != entry.name)
+		batch.produce(entry.item, "Name", name);
+	for (auto it = m.constBegin(); it != m.constEnd(); ++it) {
+		if (it.key() != "Service" && entry.fields.value(it.key()) != it.value())
+			batch.produce(entry.item, it.key(), it.value());
+	}
+	// Strength, Secured and Favorite are optional
+	for (auto it = entry.fields.constBegin(); it != entry.fields.constEnd(); ++it) {
+		if (!m.contains(it.key()))
+			batch.produce(entry.item, it.key(), QVariant());
+	}
+
+	entry.fields = m;
+	entry.name = name;
+	entry.json = QtJson::serialize(m);
+	return true;
+}
+
+/*
+ * /Network/Services is a json object with the services of every technology by name, kept
+ * for compatibility, /Network/<Tech>/Services has the same as items. Only the services
+ * which changed are serialized again, the document is assembled from the cached parts of
+ * the others.
+ */
+void NetworkController::flushServices()
+{
+	PublishBatch batch(mItem);
+	bool changed = mListDirty;
+
+	if (mListDirty) {
+		mListDirty = false;
+		syncServiceList(batch);
+	}
+
+	for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+		if (!it.value().dirty)
+			continue;
+		it.value().dirty = false;
+		if (updateEntry(it.key(), it.value(), batch))
+			changed = true;
+	}
+
+	if (!changed)
+		return;
+
+	QMap<QString, QMap<QString, QByteArray>> technologies;
+	for (auto &t: mTechnologies)
+		technologies[t];
+	for (ServiceEntry const &entry: mEntries) {
+		if (!entry.json.isEmpty())
+			technologies[entry.technology].insert(entry.name, entry.json);
+	}
+
+	QByteArray data = "{";
+	for (auto t = technologies.constBegin(); t != technologies.constEnd(); ++t) {
+		if (t != technologies.constBegin())
+			data += ",";
+		data += QtJson::serialize(t.key()) + ":{";
+		for (auto s = t.value().constBegin(); s != t.value().constEnd(); ++s) {
+			if (s != t.value().constBegin())
+				data += ",";
+			data += QtJson::serialize(s.key()) + ":" + s.value();
+		}
+		data += "}";
+	}
+	data += "}";
+
+	batch.produce(mItem, "Services", QString(data));
 }
 
 void NetworkController::handleCommand(const QVariantMap &data)
@@ -173,22 +350,20 @@ void NetworkController::handleCommand(const QVariantMap &data)
 			if (mWifiService && mWifiService != service)
 				mWifiService->disconnect();
 			mAgent->passphrase(data["Passphrase"].toString());
-			mWifiService = service;
+			setWifiService(service);
 
-			if (mWifiService) {
+			if (mWifiService)
 				mWifiService->connect();
-				connectServiceSignals(mWifiService);
-			}
 		} else if (data["Action"] == "disconnect") {
 			if (mWifiService) {
 				mWifiService->disconnect();
-				mWifiService = nullptr;
+				setWifiService(nullptr);
 			}
 		} else if (data["Action"] == "remove") {
 			if (service) {
 				service->remove();
 				if (mWifiService == service)
-					mWifiService = nullptr;
+					setWifiService(nullptr);
 			}
 		}
 	} else if (service) {
@@ -197,24 +372,14 @@ void NetworkController::handleCommand(const QVariantMap &data)
 	}
 }
 
-void NetworkController::onServiceAdded(const QString &path)
-{
-	if (!mEthernetService) {
-		CmService *s = mConnman->getService(path);
-		if (s && s->type() == "ethernet") {
-			mEthernetService = s;
-			connectServiceSignals(mEthernetService);
-			updateLinkLocal();
-		}
-	}
-}
-
 void NetworkController::onServiceRemoved(const QString &path)
 {
-	if (mEthernetService && path == mEthernetService->path()) {
-		mEthernetService = nullptr;
-		updateLinkLocal();
-	} else if (mWifiService && path == mWifiService->path()) {
+	auto it = mEntries.find(path);
+	if (it != mEntries.end())
+		eraseEntry(it);
+	onServiceListChanged();
+
+	if (mWifiService && path == mWifiService->path()) {
 		mWifiService = nullptr;
 		updateWifiState();
 	}
@@ -237,28 +402,22 @@ void NetworkController::setServiceProperties(CmService *service, const QVariantM
 		setDnsServer(service, data["Nameserver"]);
 }
 
-QString NetworkController::getLinkLocalAddr()
+void NetworkController::onAddressesChanged(const QString &interface)
 {
-	QProcess proc;
-
-	proc.start("ip -o -4 addr sh dev ll-eth0 scope link");
-	proc.waitForFinished();
-
-	QString out(proc.readAllStandardOutput());
-	QString ip = out.simplified().section(' ', 3, 3);
-
-	return ip.section('/', 0, 0);
+	if (interface == "ll-eth0")
+		updateLinkLocal();
 }
 
 void NetworkController::updateLinkLocal()
 {
-	mItem->itemGetOrCreateAndProduce("Ethernet/LinkLocalIpAddress", getLinkLocalAddr());
+	mItem->itemGetOrCreateAndProduce("Ethernet/LinkLocalIpAddress", mAddresses->linkLocalAddress("ll-eth0"));
 }
 
 void NetworkController::updateWifiState()
 {
+	PublishBatch batch(mItem);
 	QString state = mWifiService?mWifiService->state() : "idle";
-	mItem->itemGetOrCreateAndProduce("Wifi/State", state);
+	batch.produce(mItem, "Wifi/State", state);
 	if (state == "ready" || state == "online" || state == "association" || state == "configuration") {
 		updateWifiSignalStrength();
 	}
@@ -266,7 +425,8 @@ void NetworkController::updateWifiState()
 
 void NetworkController::updateWifiSignalStrength()
 {
-	mItem->itemGetOrCreateAndProduce("Wifi/SignalStrength", mWifiService ? mWifiService->strength() : 0);
+	PublishBatch batch(mItem);
+	batch.produce(mItem, "Wifi/SignalStrength", mWifiService ? mWifiService->strength() : 0);
 }
 
 void NetworkController::setIpConfiguration(CmService *service, QVariant var)
@@ -1,10 +1,15 @@
 #pragma once
 
+#include <QHash>
 #include <QObject>
+#include <QTimer>
 #include <veutil/qt/ve_qitem.hpp>
 #include <veutil/qt/ve_qitem_utils.hpp>
 #include <connman/cmmanager.h>
 
+class AddressMonitor;
+class PublishBatch;
+
 class VeQItemScan : public VeQItemAction {
 	Q_OBJECT
 
@@ -43,25 +48,51 @@ public:
 
 private slots:
 	void handleCommand(const QVariantMap &data);
-	void buildServicesList();
+	void onConnmanReady();
+	void onServiceListChanged();
+	void onServiceChanged(const QString &path);
+	void onServicePropertiesChanged();
+	void flushServices();
 	void updateLinkLocal();
+	void onAddressesChanged(const QString &interface);
 	void updateWifiState();
-	void onServiceAdded(const QString &);
 	void onServiceRemoved(const QString &);
 	void updateWifiSignalStrength();
 
 private:
+	static int const flushInterval = 250; // ms
+
+	// A connman service, its item in /Network/<Tech>/Services and its cached part of the
+	// /Network/Services json.
+	struct ServiceEntry {
+		QString technology;
+		QString name;
+		QVariantMap fields;
+		QByteArray json;
+		VeQItem *item = nullptr;
+		bool dirty = true;
+	};
+
 	QString getState(const QString &state);
-	QString getLinkLocalAddr();
 	void setServiceProperties(CmService *service, const QVariantMap &data);
 	void setIpConfiguration(CmService *service, QVariant var);
 	void setIpv4Property(CmService *service, QString name, QVariant var);
 	void setDnsServer(CmService *service, QVariant var);
 	void connectServiceSignals(CmService *service);
+	void setWifiService(CmService *service);
+	void scheduleFlush();
+	void syncServiceList(PublishBatch &batch);
+	bool updateEntry(const QString &path, ServiceEntry &entry, PublishBatch &batch);
+	QHash<QString, ServiceEntry>::iterator eraseEntry(QHash<QString, ServiceEntry>::iterator it);
 
 	CmManager *mConnman;
 	CmService *mWifiService;
-	CmService *mEthernetService;
 	CmAgent *mAgent;
 	VeQItem *mItem;
+	AddressMonitor *mAddresses;
+	QHash<QString, ServiceEntry> mEntries; // by service path
+	QStringList mTechnologies;
+	QTimer mFlushTimer;
+	bool mListDirty = true;
+	bool mWifiItemsCreated = false;
 };
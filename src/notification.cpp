@@ -2,37 +2,64 @@
 
 #include "notification.hpp"
 
-Notification::Notification(Type type, const QString &devicename, const QString &description,
-							const QString &value, const QString &serviceName,
-							const QString &alarmTrigger, const QVariant &alarmValue,
-							VeQItem *rootItem, int index, QObject *parent) :
-	QObject(parent)
-{
-	mIndexItem = rootItem->itemGetOrCreate(QString::number(index));
-	mIndexItem->itemGetOrCreateAndProduce("Service", serviceName);
-	mIndexItem->itemGetOrCreateAndProduce("DateTime", QDateTime::currentDateTime().toMSecsSinceEpoch() / 1000);
-	mIndexItem->itemGetOrCreateAndProduce("Trigger", alarmTrigger);
-	mIndexItem->itemGetOrCreateAndProduce("AlarmValue", alarmValue);
-	mIndexItem->itemGetOrCreateAndProduce("DeviceName", devicename);
-	mIndexItem->itemGetOrCreateAndProduce("Value", value);
-	mTypeItem = mIndexItem->itemGetOrCreateAndProduce("Type", type);
-	mActiveItem = mIndexItem->itemGetOrCreateAndProduce("Active", 1);
-	mAcknowledgedItem = mIndexItem->itemGetOrCreateAndProduce("Acknowledged", QVariant::fromValue(false));
-	mIndexItem->itemGetOrCreateAndProduce("Description", description);
+bool Notification::isAcknowledged() const
+{
+	return mRecord->acknowledged;
 }
 
 void Notification::setAcknowledged(bool acknowledged)
 {
 	if (acknowledged != isAcknowledged()) {
-		mAcknowledgedItem->produceValue(QVariant::fromValue(acknowledged));
+		mRecord->acknowledged = acknowledged;
 		emit acknowledgedChanged(this);
 	}
 }
 
+bool Notification::isActive() const
+{
+	return mRecord->active;
+}
+
 void Notification::setActive(bool active)
 {
 	if (active != isActive()) {
-		mActiveItem->produceValue(QVariant::fromValue(active));
+		mRecord->active = active;
 		emit activeChanged(this);
 	}
 }
+
+Notification::Type Notification::type() const
+{
+	return mRecord->type;
+}
+
+int Notification::repeatCount() const
+{
+	return mRecord->repeatCount;
+}
+
+quint32 Notification::journalId() const
+{
+	return mRecord->journalId;
+}
+
+/*
+ * The same alarm occurred again, or changed between warning and alarm, before the
+ * notification was gone. The notification is reused, so a flapping alarm doesn't push
+ * the history out.
+ */
+void Notification::repeat(Type type, const QString &description, const QString &value, const QVariant &alarmValue)
+{
+	if (!isActive()) {
+		mRecord->repeatCount++;
+		setAcknowledged(false);
+	}
+
+	mRecord->lastSeen = QDateTime::currentDateTime().toMSecsSinceEpoch() / 1000;
+	mRecord->type = type;
+	mRecord->description = description;
+	mRecord->value = value;
+	mRecord->alarmValue = alarmValue;
+
+	setActive(true);
+}
@@ -1,11 +1,12 @@
 #pragma once
 
 #include <QObject>
+#include <QVariant>
 
-#include <veutil/qt/ve_qitem.hpp>
-
-class AlarmMonitor;
+struct NotificationRecord;
 
+// A handle to a notification in the store of Notifications, for those who need to update
+// it later on, like the alarm monitors. It is destroyed when the record is evicted.
 class Notification : public QObject
 {
 	Q_OBJECT
@@ -17,12 +18,12 @@ public:
 		NOTIFICATION
 	};
 
-	explicit Notification(Type type, const QString &devicename, const QString &description,
-				const QString &value, const QString &serviceName,
-				const QString &alarmTrigger, const QVariant &alarmValue,
-				VeQItem *rootItem, int index, QObject *parent = 0);
+	explicit Notification(NotificationRecord *record, QObject *parent = 0) :
+		QObject(parent),
+		mRecord(record)
+	{}
 
-	bool isAcknowledged() const { return mAcknowledgedItem->getLocalValue().toBool(); }
+	bool isAcknowledged() const;
 	void setAcknowledged(bool acknowledged);
 
 	/*
@@ -30,19 +31,40 @@ public:
 	 * however while the alarm has not been acknowledged yet. In that case
 	 * active becomes false.
 	 */
-	bool isActive() const { return mActiveItem->getLocalValue().toBool(); }
+	bool isActive() const;
 	void setActive(bool active);
 
-	Notification::Type type() const { return static_cast<Type>(mTypeItem->getLocalValue().toInt()); }
-	int getIndex() const { return mIndexItem->id().toInt(); }
+	Notification::Type type() const;
+	int repeatCount() const;
+	quint32 journalId() const;
+	NotificationRecord *record() const { return mRecord; }
+
+	void repeat(Type type, const QString &description, const QString &value, const QVariant &alarmValue);
 
 signals:
 	void acknowledgedChanged(Notification *notification);
 	void activeChanged(Notification *notification);
 
 private:
-	VeQItem *mAcknowledgedItem;
-	VeQItem *mActiveItem;
-	VeQItem *mIndexItem;
-	VeQItem *mTypeItem;
+	NotificationRecord *mRecord;
+};
+
+// The notifications are kept as plain records, only the ones in the window are exported.
+struct NotificationRecord
+{
+	quint32 seq; // consecutive, determines the window item, see Notifications
+	quint32 journalId;
+	qint64 firstSeen;
+	qint64 lastSeen;
+	int repeatCount;
+	Notification::Type type;
+	bool active;
+	bool acknowledged;
+	QString deviceName;
+	QString description;
+	QString value;
+	QString serviceName;
+	QString trigger;
+	QVariant alarmValue;
+	Notification *handle;
 };
@@ -0,0 +1,604 @@
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "notification_journal.hpp"
+
+namespace {
+
+int const headerSize = 2 + 1 + 1 + 4 + 8;
+int const restoreSize = 8 + 4 + 1 + 1; // last seen, repeat count, active, acknowledged
+
+void putU16(QByteArray &data, quint16 value)
+{
+	data.append(char(value & 0xFF));
+	data.append(char(value >> 8));
+}
+
+void putU32(QByteArray &data, quint32 value)
+{
+	for (int n = 0; n < 4; n++)
+		data.append(char((value >> (8 * n)) & 0xFF));
+}
+
+void putI64(QByteArray &data, qint64 value)
+{
+	for (int n = 0; n < 8; n++)
+		data.append(char((quint64(value) >> (8 * n)) & 0xFF));
+}
+
+void putString(QByteArray &data, QString const &str)
+{
+	QByteArray utf8 = str.toUtf8().left(0xFFFF);
+	putU16(data, utf8.size());
+	data.append(utf8);
+}
+
+quint16 getU16(uchar const *p)
+{
+	return quint16(p[0] | (p[1] << 8));
+}
+
+quint32 getU32(uchar const *p)
+{
+	quint32 ret = 0;
+	for (int n = 3; n >= 0; n--)
+		ret = (ret << 8) | p[n];
+	return ret;
+}
+
+qint64 getI64(uchar const *p)
+{
+	quint64 ret = 0;
+	for (int n = 7; n >= 0; n--)
+		ret = (ret << 8) | p[n];
+	return qint64(ret);
+}
+
+// Reads a string at *p, not beyond end. Returns false if it doesn't fit.
+bool getString(uchar const **p, uchar const *end, QString *str)
+{
+	if (end - *p < 2)
+		return false;
+	quint16 len = getU16(*p);
+	*p += 2;
+	if (end - *p < len)
+		return false;
+	*str = QString::fromUtf8(reinterpret_cast<char const *>(*p), len);
+	*p += len;
+	return true;
+}
+
+qint64 now()
+{
+	return QDateTime::currentDateTime().toMSecsSinceEpoch() / 1000;
+}
+
+}
+
+// Writes the records with a single write and fdatasync.
+void JournalWriter::write(QString const &fileName, QByteArray const &data, qint64 size, quint32 seq)
+{
+	QByteArray const name = fileName.toLocal8Bit();
+	int fd = ::open(name.constData(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		qWarning() << "[Journal] cannot open" << fileName;
+		mLastResult = false;
+		emit written(seq, false);
+		return;
+	}
+
+	char const *p = data.constData();
+	qint64 left = data.size();
+	while (left > 0) {
+		ssize_t n = ::write(fd, p, left);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		p += n;
+		left -= n;
+	}
+
+	if (left == 0 && fdatasync(fd) < 0)
+		qWarning() << "[Journal] fdatasync failed";
+	::close(fd);
+
+	if (left != 0) {
+		// Don't leave a partial record behind, the offsets would no longer match.
+		qWarning() << "[Journal] write failed, dropping" << data.size() << "bytes";
+		if (::truncate(name.constData(), size) < 0)
+			qWarning() << "[Journal] truncating failed";
+	}
+
+	mLastResult = left == 0;
+	emit written(seq, mLastResult);
+}
+
+NotificationJournal::NotificationJournal(QString const &dir, QObject *parent) :
+	QObject(parent),
+	mDir(dir)
+{
+	QDir().mkpath(mDir);
+
+	load(ROTATED);
+	load(CURRENT);
+
+	for (Entry const &entry: mIndex) {
+		if (entry.id >= mNextId)
+			mNextId = entry.id + 1;
+	}
+
+	mFlushTimer.setSingleShot(true);
+	mFlushTimer.setInterval(30000);
+	connect(&mFlushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+
+	mWriter = new JournalWriter();
+	mWriter->moveToThread(&mThread);
+	connect(&mThread, SIGNAL(finished()), mWriter, SLOT(deleteLater()));
+	connect(mWriter, SIGNAL(written(quint32,bool)), this, SLOT(onWritten(quint32,bool)));
+	mThread.start();
+
+	qDebug() << "[Journal]" << mIndex.size() << "notifications in" << mDir;
+}
+
+NotificationJournal::~NotificationJournal()
+{
+	sync();
+	mThread.quit();
+	mThread.wait();
+	unmap(CURRENT);
+	unmap(ROTATED);
+}
+
+QString NotificationJournal::fileName(File file) const
+{
+	return mDir + (file == CURRENT ? "/journal" : "/journal.1");
+}
+
+bool NotificationJournal::map(File file) const
+{
+	Mapping &mapping = mMappings[file];
+	qint64 size = (file == CURRENT ? mFileSize : -1);
+
+	if (mapping.data && (size < 0 || mapping.size == size))
+		return true;
+	unmap(file);
+
+	int fd = ::open(fileName(file).toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED)
+		return false;
+
+	mapping.data = static_cast<uchar const *>(data);
+	mapping.size = st.st_size;
+	return true;
+}
+
+void NotificationJournal::unmap(File file) const
+{
+	Mapping &mapping = mMappings[file];
+	if (mapping.data)
+		munmap(const_cast<uchar *>(mapping.data), mapping.size);
+	mapping.data = nullptr;
+	mapping.size = 0;
+}
+
+void NotificationJournal::load(File file)
+{
+	if (file == CURRENT)
+		mFileSize = QFileInfo(fileName(file)).size();
+
+	if (!map(file))
+		return;
+
+	Mapping const &mapping = mMappings[file];
+	qint64 good = 0;
+	if (!parse(file, mapping.data, mapping.size, &good) && file == CURRENT) {
+		qWarning() << "[Journal] truncating torn record at" << good << "of" << fileName(file);
+		unmap(file);
+		if (::truncate(fileName(file).toLocal8Bit().constData(), good) < 0)
+			qWarning() << "[Journal] truncating failed";
+		mFileSize = good;
+	}
+}
+
+// Replays the records into the index. Transitions of notifications which are no longer
+// in the journal are ignored. Returns false, with the valid part in good, when the data
+// ends with a partial record.
+bool NotificationJournal::parse(File file, uchar const *data, qint64 size, qint64 *good)
+{
+	qint64 pos = 0;
+
+	while (size - pos >= headerSize) {
+		uchar const *p = data + pos;
+		quint16 len = getU16(p);
+		if (len < headerSize || size - pos < len)
+			break;
+
+		quint8 kind = p[2];
+		quint32 id = getU32(p + 4);
+		qint64 time = getI64(p + 8);
+		uchar const *payload = p + headerSize;
+
+		if (kind == ADD) {
+			Entry entry;
+			entry.file = file;
+			entry.offset = quint32(pos);
+			entry.id = id;
+			entry.type = p[3];
+			entry.lastSeen = time;
+			entry.repeatCount = 0;
+			entry.active = true;
+			entry.acknowledged = false;
+			mIndex.append(entry);
+		} else if (kind == RESTORE && len >= headerSize + restoreSize) {
+			// A notification carried over from an older journal, so its id is lower.
+			Entry entry;
+			entry.file = file;
+			entry.offset = quint32(pos);
+			entry.id = id;
+			entry.type = p[3];
+			entry.lastSeen = getI64(payload);
+			entry.repeatCount = getU32(payload + 8);
+			entry.active = payload[12];
+			entry.acknowledged = payload[13];
+			auto it = std::upper_bound(mIndex.begin(), mIndex.end(), id, [](quint32 id, Entry const &e) {
+				return id < e.id;
+			});
+			mIndex.insert(it, entry);
+		} else if (Entry *entry = find(id)) {
+			switch (kind) {
+			case ACTIVE:
+				entry->active = len > headerSize && payload[0];
+				break;
+			case ACKNOWLEDGED:
+				entry->acknowledged = len > headerSize && payload[0];
+				break;
+			case REPEAT:
+				entry->type = p[3];
+				entry->lastSeen = time;
+				if (!entry->active) {
+					entry->repeatCount++;
+					entry->acknowledged = false;
+				}
+				entry->active = true;
+				break;
+			default:
+				break;
+			}
+		}
+
+		pos += len;
+	}
+
+	*good = pos;
+	return pos == size;
+}
+
+NotificationJournal::Entry *NotificationJournal::find(quint32 id)
+{
+	// The ids are ascending, recent notifications are looked up most.
+	for (int n = mIndex.size() - 1; n >= 0; n--) {
+		if (mIndex[n].id == id)
+			return &mIndex[n];
+		if (mIndex[n].id < id)
+			break;
+	}
+	return nullptr;
+}
+
+void NotificationJournal::append(Kind kind, int type, quint32 id, qint64 time, QByteArray const &payload)
+{
+	if (headerSize + payload.size() > 0xFFFF)
+		return;
+
+	// Rotated once the batch being written is done, see onWritten.
+	if (!mRotate && endOffset() + headerSize + payload.size() > maxSize) {
+		mRotate = true;
+		if (mWriting.isEmpty())
+			rotate();
+	}
+
+	putU16(mPending, headerSize + payload.size());
+	mPending.append(char(kind));
+	mPending.append(char(type));
+	putU32(mPending, id);
+	putI64(mPending, time);
+	mPending.append(payload);
+
+	if (!mFlushTimer.isActive())
+		mFlushTimer.start();
+}
+
+quint32 NotificationJournal::add(Record const &record)
+{
+	Entry entry;
+	entry.file = CURRENT;
+	entry.id = mNextId++;
+	entry.type = quint8(record.type);
+	entry.lastSeen = record.dateTime;
+	entry.repeatCount = 0;
+	entry.active = true;
+	entry.acknowledged = false;
+
+	QByteArray payload;
+	putString(payload, record.deviceName);
+	putString(payload, record.description);
+	putString(payload, record.value);
+	putString(payload, record.serviceName);
+	putString(payload, record.trigger);
+	putString(payload, record.alarmValue);
+
+	append(ADD, record.type, entry.id, record.dateTime, payload);
+	// after append, since it might have rotated
+	entry.offset = quint32(endOffset() - headerSize - payload.size());
+	mIndex.append(entry);
+
+	return entry.id;
+}
+
+void NotificationJournal::setActive(quint32 id, bool active)
+{
+	Entry *entry = find(id);
+	if (!entry || entry->active == active)
+		return;
+
+	entry->active = active;
+	append(ACTIVE, 0, id, now(), QByteArray(1, char(active)));
+}
+
+void NotificationJournal::setAcknowledged(quint32 id, bool acknowledged)
+{
+	Entry *entry = find(id);
+	if (!entry || entry->acknowledged == acknowledged)
+		return;
+
+	entry->acknowledged = acknowledged;
+	append(ACKNOWLEDGED, 0, id, now(), QByteArray(1, char(acknowledged)));
+}
+
+void NotificationJournal::repeat(quint32 id, int type)
+{
+	Entry *entry = find(id);
+	if (!entry)
+		return;
+
+	entry->type = quint8(type);
+	entry->lastSeen = now();
+	if (!entry->active) {
+		entry->repeatCount++;
+		entry->acknowledged = false;
+	}
+	entry->active = true;
+	append(REPEAT, type, id, entry->lastSeen, QByteArray());
+}
+
+// Hands the pending records to the writer. If a batch is still being written, they are
+// written once it is done.
+void NotificationJournal::flush()
+{
+	mFlushTimer.stop();
+	if (mPending.isEmpty() || !mWriting.isEmpty())
+		return;
+
+	mWriting.swap(mPending);
+	QMetaObject::invokeMethod(mWriter, "write", Qt::QueuedConnection,
+							  Q_ARG(QString, fileName(CURRENT)), Q_ARG(QByteArray, mWriting),
+							  Q_ARG(qint64, mFileSize), Q_ARG(quint32, ++mWriteSeq));
+}
+
+void NotificationJournal::onWritten(quint32 seq, bool ok)
+{
+	// Already handled by sync().
+	if (seq != mWriteSeq || mWriting.isEmpty())
+		return;
+
+	writeDone(ok);
+
+	if (mRotate)
+		rotate();
+
+	// A flush requested while writing, otherwise the flush timer is running.
+	if (!mPending.isEmpty() && !mFlushTimer.isActive())
+		flush();
+}
+
+void NotificationJournal::writeDone(bool ok)
+{
+	qint64 const written = mWriting.size();
+
+	if (ok) {
+		mFileSize += written;
+	} else {
+		// The records of the batch are gone, the pending ones move up.
+		mIndex.erase(std::remove_if(mIndex.begin(), mIndex.end(), [this, written](Entry const &entry) {
+			return entry.file == CURRENT && entry.offset >= mFileSize && entry.offset < mFileSize + written;
+		}), mIndex.end());
+		for (Entry &entry: mIndex) {
+			if (entry.file == CURRENT && entry.offset >= mFileSize + written)
+				entry.offset -= written;
+		}
+	}
+	mWriting.clear();
+}
+
+// Writes all records and waits for it, when destructed.
+void NotificationJournal::sync()
+{
+	for (int n = 0; n < 2; n++) {
+		if (!mWriting.isEmpty()) {
+			bool ok = false;
+			// The writer handles its calls in order, so this returns after the batch is written.
+			QMetaObject::invokeMethod(mWriter, "lastResult", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, ok));
+			writeDone(ok);
+		}
+		flush();
+	}
+}
+
+/*
+ * Called without a batch being written, so the current journal is complete on disk up to
+ * mFileSize, the records after it are pending. The notifications in the rotated journal
+ * are dropped, except for the most recent ones, which might still be updated. These are
+ * carried over to the new journal with their latest state, before the pending records.
+ * Only the rename is done here, the new journal is written by the writer as usual.
+ */
+void NotificationJournal::rotate()
+{
+	QByteArray carried;
+	QHash<quint32, quint32> carriedOffsets; // by id
+	int firstKept = mIndex.size() - mKeep;
+
+	mRotate = false;
+
+	for (int n = qMax(firstKept, 0); n < mIndex.size(); n++) {
+		Entry const &entry = mIndex[n];
+		if (entry.file != ROTATED)
+			continue;
+
+		Record record = read(entry);
+		QByteArray payload;
+		putI64(payload, entry.lastSeen);
+		putU32(payload, entry.repeatCount);
+		payload.append(char(entry.active));
+		payload.append(char(entry.acknowledged));
+		putString(payload, record.deviceName);
+		putString(payload, record.description);
+		putString(payload, record.value);
+		putString(payload, record.serviceName);
+		putString(payload, record.trigger);
+		putString(payload, record.alarmValue);
+		if (headerSize + payload.size() > 0xFFFF)
+			continue;
+
+		carriedOffsets.insert(entry.id, quint32(carried.size()));
+		putU16(carried, headerSize + payload.size());
+		carried.append(char(RESTORE));
+		carried.append(char(entry.type));
+		putU32(carried, entry.id);
+		putI64(carried, record.dateTime);
+		carried.append(payload);
+	}
+
+	unmap(CURRENT);
+	unmap(ROTATED);
+
+	if (::rename(fileName(CURRENT).toLocal8Bit().constData(), fileName(ROTATED).toLocal8Bit().constData()) < 0) {
+		qWarning() << "[Journal] rotating failed";
+		return;
+	}
+
+	for (Entry &entry: mIndex) {
+		if (entry.file == ROTATED) {
+			auto it = carriedOffsets.constFind(entry.id);
+			if (it == carriedOffsets.constEnd()) {
+				entry.file = 0xFF; // dropped below
+				continue;
+			}
+			entry.file = CURRENT;
+			entry.offset = it.value();
+		} else if (entry.offset < mFileSize) {
+			entry.file = ROTATED;
+		} else {
+			entry.offset = quint32(entry.offset - mFileSize + carried.size());
+		}
+	}
+	mIndex.erase(std::remove_if(mIndex.begin(), mIndex.end(), [](Entry const &entry) {
+		return entry.file == 0xFF;
+	}), mIndex.end());
+
+	mFileSize = 0;
+	mPending.prepend(carried);
+	if (!mPending.isEmpty() && !mFlushTimer.isActive())
+		mFlushTimer.start();
+
+	// The latest state of the notifications which are still shown is in the index
+	// only now, write it to the new journal, so it is restored after a restart.
+	for (Entry const &entry: mIndex) {
+		if (entry.file != ROTATED)
+			continue;
+		if (!entry.active)
+			append(ACTIVE, 0, entry.id, entry.lastSeen, QByteArray(1, char(0)));
+		if (entry.acknowledged)
+			append(ACKNOWLEDGED, 0, entry.id, entry.lastSeen, QByteArray(1, char(1)));
+	}
+}
+
+NotificationJournal::Record NotificationJournal::read(Entry const &entry) const
+{
+	Record record;
+	record.id = entry.id;
+	record.type = entry.type;
+	record.dateTime = entry.lastSeen;
+	record.lastSeen = entry.lastSeen;
+	record.repeatCount = entry.repeatCount;
+	record.active = entry.active;
+	record.acknowledged = entry.acknowledged;
+
+	uchar const *data;
+	qint64 size;
+	File file = static_cast<File>(entry.file);
+
+	if (file == CURRENT && entry.offset >= mFileSize) {
+		// not written yet
+		qint64 offset = entry.offset - mFileSize;
+		QByteArray const &buffer = offset < mWriting.size() ? mWriting : mPending;
+		if (offset >= mWriting.size())
+			offset -= mWriting.size();
+		data = reinterpret_cast<uchar const *>(buffer.constData()) + offset;
+		size = buffer.size() - offset;
+	} else {
+		if (!map(file))
+			return record;
+		data = mMappings[file].data + entry.offset;
+		size = mMappings[file].size - entry.offset;
+	}
+
+	if (size < headerSize || getU16(data) > size)
+		return record;
+
+	uchar const *end = data + getU16(data);
+	uchar const *p = data + headerSize;
+	if (data[2] == RESTORE)
+		p += restoreSize;
+	record.dateTime = getI64(data + 8);
+	getString(&p, end, &record.deviceName) &&
+		getString(&p, end, &record.description) &&
+		getString(&p, end, &record.value) &&
+		getString(&p, end, &record.serviceName) &&
+		getString(&p, end, &record.trigger) &&
+		getString(&p, end, &record.alarmValue);
+
+	return record;
+}
+
+QList<NotificationJournal::Record> NotificationJournal::page(int offset, int count) const
+{
+	QList<Record> ret;
+
+	for (int n = mIndex.size() - 1 - offset; n >= 0 && ret.size() < count; n--)
+		ret.append(read(mIndex[n]));
+
+	return ret;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QVariant>
+#include <QVector>
+
+// Appends a batch of records to the journal and flushes it. Runs in its own thread, so
+// an fdatasync to a slow SD card or eMMC doesn't delay the alarms.
+class JournalWriter : public QObject
+{
+	Q_OBJECT
+
+public slots:
+	// A failed write is truncated to size again, the size of the file before it.
+	void write(QString const &fileName, QByteArray const &data, qint64 size, quint32 seq);
+	bool lastResult() const { return mLastResult; }
+
+signals:
+	void written(quint32 seq, bool ok);
+
+private:
+	bool mLastResult = true;
+};
+
+// An append-only journal of the notifications on /data, so the history survives a
+// restart and is not limited to the notifications kept in memory. Besides the added
+// notifications, their acknowledge / active transitions and repeats are recorded. The
+// texts returned are those of the first occurrence, repeats only update the state and
+// the type, e.g. a warning which returned as an alarm, so they have no payload.
+//
+// Records are buffered and written in batches followed by a single fdatasync, to
+// limit the flash wear, by the JournalWriter. Until written, the batch is kept for
+// reading. When the journal exceeds maxSize, it is rotated to journal.1 once the batch
+// being written is done, so at most two journals are kept. The journals are mmap'd for
+// reading, an index of the notifications with their latest state is kept in memory.
+//
+// A record is a little endian header, length (u16), kind (u8), notification type (u8),
+// id (u32) and time (s since epoch, i64), followed by the payload of the kind. Strings
+// are a u16 length followed by the utf-8 data. A torn record at the end, e.g. after a
+// power loss, is truncated when opening.
+class NotificationJournal : public QObject
+{
+	Q_OBJECT
+
+public:
+	struct Record {
+		quint32 id;
+		int type;
+		qint64 dateTime;
+		qint64 lastSeen;
+		int repeatCount;
+		bool active;
+		bool acknowledged;
+		QString deviceName;
+		QString description;
+		QString value;
+		QString serviceName;
+		QString trigger;
+		QString alarmValue;
+	};
+
+	NotificationJournal(QString const &dir = "/data/venus/notifications", QObject *parent = 0);
+	~NotificationJournal();
+
+	quint32 add(Record const &record);
+	void setActive(quint32 id, bool active);
+	void setAcknowledged(quint32 id, bool acknowledged);
+	void repeat(quint32 id, int type);
+	// The most recent notifications which can still be updated, e.g. those shown. These
+	// are kept when rotating.
+	void setKeep(int count) { mKeep = count; }
+
+	int count() const { return mIndex.size(); }
+	// Offset 0 is the most recent notification.
+	QList<Record> page(int offset, int count) const;
+
+public slots:
+	void flush();
+
+private slots:
+	void onWritten(quint32 seq, bool ok);
+
+private:
+	enum Kind {
+		ADD = 1,
+		ACTIVE,
+		ACKNOWLEDGED,
+		REPEAT,
+		RESTORE // ADD with the state, for notifications carried over when rotating
+	};
+
+	enum File {
+		CURRENT,
+		ROTATED
+	};
+
+	struct Entry {
+		quint8 file;
+		quint32 offset;
+		quint32 id;
+		quint8 type; // the latest, repeats can change it
+		qint64 lastSeen;
+		quint32 repeatCount;
+		bool active;
+		bool acknowledged;
+	};
+
+	struct Mapping {
+		uchar const *data = nullptr;
+		qint64 size = 0;
+	};
+
+	void load(File file);
+	bool parse(File file, uchar const *data, qint64 size, qint64 *good);
+	void append(Kind kind, int type, quint32 id, qint64 time, QByteArray const &payload);
+	void rotate();
+	void writeDone(bool ok);
+	void sync();
+	qint64 endOffset() const { return mFileSize + mWriting.size() + mPending.size(); }
+	bool map(File file) const;
+	void unmap(File file) const;
+	Entry *find(quint32 id);
+	Record read(Entry const &entry) const;
+	QString fileName(File file) const;
+
+	QString mDir;
+	QVector<Entry> mIndex;
+	QByteArray mPending;
+	QByteArray mWriting; // handed to the writer, directly after mFileSize
+	quint32 mWriteSeq = 0;
+	bool mRotate = false;
+	int mKeep = 0;
+	qint64 mFileSize = 0; // written
+	quint32 mNextId = 1;
+	QTimer mFlushTimer;
+	mutable Mapping mMappings[2];
+	QThread mThread;
+	JournalWriter *mWriter;
+
+	static qint64 const maxSize = 128 * 1024;
+};
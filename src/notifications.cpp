@@ -1,130 +1,426 @@
-#include <QTimer>
+#include <QDateTime>
 #include <QDebug>
 
+#include "alarm_stats.hpp"
 #include "application.hpp"
+#include "json.h"
+#include "network_controller.h"
+#include "notification_journal.hpp"
 #include "notifications.hpp"
+#include "publish_batch.hpp"
 
 Notifications::Notifications(VeQItem *parentItem, QObject *parent) :
 	QObject(parent)
 {
+	mStore.resize(mMaxNotifications);
+
 	mNoficationsItem = parentItem->itemGetOrCreate("Notifications");
 	mNumberOfNotificationsItem = mNoficationsItem->itemGetOrCreate("NumberOfNotifications");
 	mNumberOfActiveNotificationsItem = mNoficationsItem->itemGetOrCreate("NumberOfActiveNotifications");
+	mNumberOfStoredNotificationsItem = mNoficationsItem->itemGetOrCreate("NumberOfStoredNotifications");
 	mAlarmItem = mNoficationsItem->itemGetOrCreate("Alarm");
 	mAlertItem = mNoficationsItem->itemGetOrCreate("Alert");
 	mNoficationsItem->itemAddChild("AcknowledgeAll", new VeQItemAcknowledgeAll(this));
 
-	//QTimer::singleShot(9000, this, SLOT(test()));
+	VeQItem *window = mNoficationsItem->itemGetOrCreate("Window");
+	mWindowOffsetItem = new VeQItemNotificationWindow(this, true);
+	window->itemAddChild("Offset", mWindowOffsetItem);
+	mWindowOffsetItem->produceValue(mWindowOffset);
+	mWindowCountItem = new VeQItemNotificationWindow(this, false);
+	window->itemAddChild("Count", mWindowCountItem);
+	mWindowCountItem->produceValue(mWindowCount);
+
+	/*
+	 * The full history is kept in a journal on /data. Write {"Offset": n, "Count": n}
+	 * to History/Query to get that part of it, most recent first, in History/Page.
+	 */
+	mJournal = new NotificationJournal("/data/venus/notifications", this);
+	mJournal->setKeep(mMaxNotifications);
+	VeQItem *history = mNoficationsItem->itemGetOrCreate("History");
+	mHistoryCountItem = history->itemGetOrCreateAndProduce("Count", mJournal->count());
+	mHistoryPageItem = history->itemGetOrCreateAndProduce("Page", "[]");
+	VeQItemJson *query = new VeQItemJson();
+	history->itemAddChild("Query", query);
+	connect(query, SIGNAL(jsonParsed(QVariantMap)), this, SLOT(onHistoryQuery(QVariantMap)));
+
+	restore();
 }
 
-void Notifications::acknowledgedAll()
+int VeQItemNotificationWindow::setValue(const QVariant &value)
 {
-	for (Notification *notification: mNotifications)
-		notification->setAcknowledged(true);
+	bool ok;
+	int n = value.toInt(&ok);
+	if (!ok || n < 0)
+		return -1;
+
+	if (mOffset)
+		mNotifications->setWindow(n, -1);
+	else
+		mNotifications->setWindow(-1, n);
 
-	setAlert(false);
-	setAlarm(false);
+	return 0;
 }
 
-void Notifications::updateAlert()
+/*
+ * The records are acknowledged directly, without the signals of their handles, and the
+ * counters are published once. Only unacknowledged records can be affected, once there
+ * are no more of those, the rest of the store isn't visited.
+ */
+void Notifications::acknowledgedAll()
 {
-	for (Notification *notification: mNotifications) {
-		if (!notification->isAcknowledged()) {
-			setAlert(true);
-			return;
-		}
+	for (int n = 0; n < mCount && mUnacknowledged > 0; n++) {
+		NotificationRecord &record = at(n);
+		if (record.acknowledged)
+			continue;
+
+		account(record, -1);
+		record.acknowledged = true;
+		account(record, 1);
+		mJournal->setAcknowledged(record.journalId, true);
+		publish(record);
 	}
 
-	setAlert(false);
+	publishCounters();
 }
 
-void Notifications::updateAlarm()
+// Adds / removes the record from the counters, before and after it changes.
+void Notifications::account(NotificationRecord const &record, int sign)
 {
-	int activeNotifications = 0;
-	bool alarm = false;
+	if (record.active)
+		mActive += sign;
+	if (!record.acknowledged)
+		mUnacknowledged += sign;
+	if (record.active && !record.acknowledged && record.type == Notification::ALARM)
+		mUnacknowledgedAlarms += sign;
+}
 
-	for (Notification *notification: mNotifications) {
-		if (notification->isActive()) {
-			activeNotifications++;
-			if (!alarm && notification->type() == Notification::ALARM && !notification->isAcknowledged()) {
-				alarm = true;
-			}
-		}
-	}
+// In the same batch as the window items, so clients don't see the alarm or the new count
+// before the notification itself. NumberOfNotifications is the number of Notifications/<n>
+// items, like before there was a window, NumberOfStoredNotifications that of the store.
+void Notifications::publishCounters()
+{
+	PublishBatch batch(mNoficationsItem);
 
-	mNumberOfActiveNotificationsItem->produceValue(activeNotifications);
-	mNumberOfNotificationsItem->produceValue(mNotifications.length());
-	setAlarm(alarm);
+	batch.produce(mNumberOfActiveNotificationsItem, mActive);
+	batch.produce(mNumberOfNotificationsItem, qBound(0, mCount - mWindowOffset, mWindowCount));
+	batch.produce(mNumberOfStoredNotificationsItem, mCount);
+	setAlarm(mUnacknowledgedAlarms > 0);
+	setAlert(mUnacknowledged > 0);
 }
 
 void Notifications::setAlert(bool alert)
 {
-	if (alert != isAlert()) {
-		mAlertItem->produceValue(QVariant::fromValue(alert));
+	if (alert != mAlert) {
+		mAlert = alert;
+		PublishBatch batch(mNoficationsItem);
+		batch.produce(mAlertItem, QVariant::fromValue(alert));
 		emit alertChanged();
 	}
 }
 
 void Notifications::setAlarm(bool alarm)
 {
-	if (alarm != isAlarm()) {
-		mAlarmItem->produceValue(QVariant::fromValue(alarm));
+	if (alarm != mAlarm) {
+		mAlarm = alarm;
+		if (AlarmStats::instance())
+			AlarmStats::instance()->alarmChanged(alarm);
+		PublishBatch batch(mNoficationsItem);
+		batch.produce(mAlarmItem, QVariant::fromValue(alarm));
 		emit alarmChanged();
 	}
 }
 
+/*
+ * Takes the slot of the oldest record when the store is full. Its handle is destroyed,
+ * so whoever kept it knows it is gone. The record is active, not acknowledged and
+ * becomes the most recent one. It must be accounted once filled in.
+ */
+NotificationRecord &Notifications::createRecord()
+{
+	int evicted = -1;
+
+	if (mCount == static_cast<int>(mStore.size())) {
+		NotificationRecord &oldest = at(mCount - 1);
+		evicted = oldest.seq;
+		account(oldest, -1);
+		delete oldest.handle;
+		mCount--;
+	}
+
+	mHead = (mHead + 1) % mStore.size();
+	mCount++;
+
+	NotificationRecord &record = at(0);
+	record = NotificationRecord();
+	record.seq = mNextSeq++;
+	record.journalId = 0;
+	record.firstSeen = QDateTime::currentDateTime().toMSecsSinceEpoch() / 1000;
+	record.lastSeen = record.firstSeen;
+	record.repeatCount = 0;
+	record.type = Notification::NOTIFICATION;
+	record.active = true;
+	record.acknowledged = false;
+	record.handle = nullptr;
+
+	// The evicted record left the window, unless its item is reused by another one.
+	if (evicted >= 0 && mWindowCount > 0 && mWindowOffset < mCount && mWindowOffset + mWindowCount >= mCount) {
+		int n = evicted % mWindowCount;
+		if (at(mWindowOffset).seq % mWindowCount != static_cast<quint32>(n))
+			clearWindowItem(n);
+	}
+
+	return record;
+}
+
 Notification *Notifications::addNotification(Notification::Type type, const QString &devicename,
 											 const QString &value, const QString description, const QString &alarmTrigger,
 											 const QVariant &alarmValue, const QString &serviceName)
 {
-	Notification *notification;
-	int index = mNotifications.size();
-	int activeNotifications = mNumberOfActiveNotificationsItem->getValue().toInt();
+	NotificationRecord &record = createRecord();
+	record.type = type;
+	record.deviceName = devicename;
+	record.description = description;
+	record.value = value;
+	record.serviceName = serviceName;
+	record.trigger = alarmTrigger;
+	record.alarmValue = alarmValue;
+	account(record, 1);
 
-	if (mNotifications.size() >= mMaxNotifications) {
-		notification = mNotifications.last();
-		index = notification->getIndex();
-		if (notification->isActive())
-			activeNotifications--;
-		removeNotification(notification);
-	}
+	NotificationJournal::Record entry;
+	entry.type = type;
+	entry.dateTime = record.firstSeen;
+	entry.deviceName = devicename;
+	entry.description = description;
+	entry.value = value;
+	entry.serviceName = serviceName;
+	entry.trigger = alarmTrigger;
+	entry.alarmValue = alarmValue.toString();
+	record.journalId = mJournal->add(entry);
+	mHistoryCountItem->produceValue(mJournal->count());
 
-	notification = new Notification(type, devicename, description, value, serviceName, alarmTrigger, alarmValue, mNoficationsItem, index, this);
-	mNotifications.insert(0, notification);
+	Notification *notification = new Notification(&record, this);
+	record.handle = notification;
 	connect(notification, SIGNAL(activeChanged(Notification *)), this, SLOT(activeChanged(Notification *)));
-	mNumberOfNotificationsItem->produceValue(mNotifications.length());
+	connect(notification, SIGNAL(acknowledgedChanged(Notification *)), this, SLOT(acknowledgedChanged(Notification *)));
 
-	if (notification->type() == Notification::ALARM)
-		setAlarm(true);
+	// The new notification shifts the window by one, only the one entering it changes.
+	if (mWindowOffset < mCount)
+		publish(at(mWindowOffset));
 
-	if (notification->isActive()) {
-		activeNotifications++;
-		setAlert(true);
-		mNumberOfActiveNotificationsItem->produceValue(activeNotifications);
-	}
+	publishCounters();
 
 	return notification;
 }
 
+void Notifications::repeatNotification(Notification *notification, Notification::Type type, const QString &value,
+										const QString &description, const QVariant &alarmValue)
+{
+	NotificationRecord &record = *notification->record();
+
+	// The type might change as well, so account the record as a whole. The journal and
+	// the window are updated below, so the signals of the handle are not needed.
+	account(record, -1);
+	notification->blockSignals(true);
+	notification->repeat(type, description, value, alarmValue);
+	notification->blockSignals(false);
+	account(record, 1);
+
+	mJournal->repeat(record.journalId, type);
+	publish(record);
+	publishCounters();
+}
+
+void Notifications::setDebounce(QVariant var)
+{
+	if (var.isValid())
+		mDebounce = var.toInt();
+}
+
+void Notifications::setFlapWindow(QVariant var)
+{
+	if (var.isValid())
+		mFlapWindow = var.toInt();
+}
+
+/*
+ * The notification is no longer relevant, e.g. the mk3 firmware was updated. The record
+ * remains in the history, as inactive and acknowledged, but can no longer be updated.
+ */
 void Notifications::removeNotification(Notification *notification)
 {
+	NotificationRecord *record = notification->record();
+
 	notification->setActive(false);
-	mNotifications.removeOne(notification);
+	notification->setAcknowledged(true);
+	record->handle = nullptr;
 	delete notification;
-	updateAlarm();
-	updateAlert();
 }
 
+// The handle already changed the record, it was the opposite before.
 void Notifications::activeChanged(Notification *notification)
 {
-	Q_UNUSED(notification);
-	updateAlarm();
-	updateAlert();
+	NotificationRecord &record = *notification->record();
+
+	record.active = !record.active;
+	account(record, -1);
+	record.active = !record.active;
+	account(record, 1);
+
+	mJournal->setActive(record.journalId, record.active);
+	publish(record);
+	publishCounters();
+}
+
+void Notifications::acknowledgedChanged(Notification *notification)
+{
+	NotificationRecord &record = *notification->record();
+
+	record.acknowledged = !record.acknowledged;
+	account(record, -1);
+	record.acknowledged = !record.acknowledged;
+	account(record, 1);
+
+	mJournal->setAcknowledged(record.journalId, record.acknowledged);
+	publish(record);
+	publishCounters();
+}
+
+// The position of the record in the store, 0 being the most recent one.
+int Notifications::position(NotificationRecord const &record) const
+{
+	return static_cast<int>(mNextSeq - 1 - record.seq);
+}
+
+void Notifications::setWindow(int offset, int count)
+{
+	if (offset >= 0)
+		mWindowOffset = qMin(offset, mMaxNotifications);
+	if (count >= 0)
+		mWindowCount = qMin(count, mMaxWindow);
+
+	mWindowOffsetItem->produceValue(mWindowOffset);
+	mWindowCountItem->produceValue(mWindowCount);
+	publishWindow();
+	publishCounters();
 }
 
-void Notifications::test()
+void Notifications::publishWindow()
 {
-	qDebug() << "NotificationCenter test()";
-	addNotification(Notification::ALARM, "Multi", "VeBus error", "value");
-	addNotification(Notification::NOTIFICATION, "Multi", "VeBus error", "value");
+	for (int n = 0; n < mWindowItems.size(); n++) {
+		int pos = -1;
+
+		if (n < mWindowCount) {
+			// the position in the window whose seq maps to item n
+			for (int i = 0; i < mWindowCount && mWindowOffset + i < mCount; i++) {
+				if (at(mWindowOffset + i).seq % mWindowCount == static_cast<quint32>(n)) {
+					pos = mWindowOffset + i;
+					break;
+				}
+			}
+		}
+
+		if (pos < 0)
+			clearWindowItem(n);
+	}
+
+	for (int i = 0; i < mWindowCount && mWindowOffset + i < mCount; i++)
+		publish(at(mWindowOffset + i));
+}
+
+// Exports the record, if it is in the window. Only the items which changed are produced,
+// all at once when the event loop continues.
+void Notifications::publish(NotificationRecord const &record)
+{
+	int pos = position(record);
+	if (mWindowCount == 0 || pos < mWindowOffset || pos >= mWindowOffset + mWindowCount)
+		return;
+
+	int n = record.seq % mWindowCount;
+	while (mWindowItems.size() <= n)
+		mWindowItems.append(mNoficationsItem->itemGetOrCreate(QString::number(mWindowItems.size())));
+	VeQItem *item = mWindowItems[n];
+	PublishBatch batch(mNoficationsItem);
+
+	batch.produce(item, "Service", record.serviceName);
+	batch.produce(item, "DateTime", record.firstSeen);
+	batch.produce(item, "FirstSeen", record.firstSeen);
+	batch.produce(item, "LastSeen", record.lastSeen);
+	batch.produce(item, "RepeatCount", record.repeatCount);
+	batch.produce(item, "Trigger", record.trigger);
+	batch.produce(item, "AlarmValue", record.alarmValue);
+	batch.produce(item, "DeviceName", record.deviceName);
+	batch.produce(item, "Value", record.value);
+	batch.produce(item, "Type", record.type);
+	batch.produce(item, "Active", QVariant::fromValue(record.active));
+	batch.produce(item, "Acknowledged", QVariant::fromValue(record.acknowledged));
+	batch.produce(item, "Description", record.description);
+}
+
+void Notifications::clearWindowItem(int n)
+{
+	if (n >= mWindowItems.size())
+		return;
+
+	PublishBatch batch(mNoficationsItem);
+	for (VeQItem *child: mWindowItems[n]->itemChildren())
+		batch.produce(child, QVariant());
+}
+
+/*
+ * Shows the most recent notifications of the journal again after a restart. Alarms which
+ * are still present are raised again by their monitor, so these are no longer active.
+ */
+void Notifications::restore()
+{
+	QList<NotificationJournal::Record> entries = mJournal->page(0, mMaxNotifications);
+
+	for (int n = entries.size() - 1; n >= 0; n--) {
+		NotificationJournal::Record const &entry = entries[n];
+		NotificationRecord &record = createRecord();
+		record.journalId = entry.id;
+		record.type = static_cast<Notification::Type>(entry.type);
+		record.firstSeen = entry.dateTime;
+		record.lastSeen = entry.lastSeen;
+		record.repeatCount = entry.repeatCount;
+		record.acknowledged = entry.acknowledged;
+		record.active = false;
+		record.deviceName = entry.deviceName;
+		record.description = entry.description;
+		record.value = entry.value;
+		record.serviceName = entry.serviceName;
+		record.trigger = entry.trigger;
+		record.alarmValue = entry.alarmValue;
+		account(record, 1);
+		mJournal->setActive(record.journalId, false);
+	}
+
+	publishWindow();
+	publishCounters();
+}
+
+void Notifications::onHistoryQuery(const QVariantMap &data)
+{
+	int offset = qMax(data.value("Offset").toInt(), 0);
+	int count = qBound(0, data.value("Count", 20).toInt(), 100);
+	QVariantList page;
+
+	for (NotificationJournal::Record const &record: mJournal->page(offset, count)) {
+		QVariantMap map;
+		map["Id"] = record.id;
+		map["Type"] = record.type;
+		map["DateTime"] = record.dateTime;
+		map["LastSeen"] = record.lastSeen;
+		map["RepeatCount"] = record.repeatCount;
+		map["Active"] = record.active;
+		map["Acknowledged"] = record.acknowledged;
+		map["DeviceName"] = record.deviceName;
+		map["Description"] = record.description;
+		map["Value"] = record.value;
+		map["Service"] = record.serviceName;
+		map["Trigger"] = record.trigger;
+		map["AlarmValue"] = record.alarmValue;
+		page.append(map);
+	}
+
+	mHistoryPageItem->produceValue(QString::fromUtf8(QtJson::serialize(page)));
 }
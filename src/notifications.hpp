@@ -5,8 +5,19 @@
 #include <veutil/qt/ve_qitem.hpp>
 #include <veutil/qt/ve_qitem_utils.hpp>
 
+#include <vector>
+
 #include "notification.hpp"
 
+class NotificationJournal;
+
+/*
+ * The notifications are kept in a ring of plain records, the most recent one first.
+ * Only a window of them, selected with Window/Offset and Window/Count, is exported as
+ * Notifications/<n>/... items. Since the seq of the records is consecutive, <n> is the
+ * seq modulo the window size, so a new notification only rewrites the item of the one
+ * which left the window.
+ */
 class Notifications : public QObject
 {
 	Q_OBJECT
@@ -14,8 +25,9 @@ class Notifications : public QObject
 public:
 	explicit Notifications(VeQItem *parentItem, QObject *parent = 0);
 
-	bool isAlert() const { return mAlertItem->getLocalValue().toBool(); }
-	bool isAlarm() const { return mAlarmItem->getLocalValue().toBool(); }
+	// The items follow when the event loop continues, see publishCounters.
+	bool isAlert() const { return mAlert; }
+	bool isAlarm() const { return mAlarm; }
 
 	Notification* addNotification(Notification::Type type, const QString &devicename,
 									const QString &value, const QString description,
@@ -23,31 +35,72 @@ public:
 									const QVariant &alarmValue = "",
 									const QString &serviceName = "");
 
+	void repeatNotification(Notification *notification, Notification::Type type, const QString &value,
+							const QString &description, const QVariant &alarmValue);
 	void removeNotification(Notification *notification);
 	void acknowledgedAll();
 
+	// How long an alarm must be present before it is notified, in ms.
+	int debounce() const { return mDebounce; }
+	// Within this time, in seconds, an alarm which returns reuses its notification.
+	int flapWindow() const { return mFlapWindow; }
+
+	void setWindow(int offset, int count);
+
+public slots:
+	void setDebounce(QVariant var);
+	void setFlapWindow(QVariant var);
+
 signals:
 	void alertChanged();
 	void alarmChanged();
 
 private slots:
 	void activeChanged(Notification *notification);
-	void test();
+	void acknowledgedChanged(Notification *notification);
+	void onHistoryQuery(const QVariantMap &data);
 
 private:
-	void updateAlert();
-	void updateAlarm();
+	void account(NotificationRecord const &record, int sign);
+	void publishCounters();
 	void setAlert(bool alert);
 	void setAlarm(bool alarm);
-
-	QList<Notification *> mNotifications;
-	int const mMaxNotifications = 20;
+	void restore();
+	NotificationRecord &createRecord();
+	NotificationRecord &at(int position) { return mStore[(mHead + mStore.size() - position) % mStore.size()]; }
+	int position(NotificationRecord const &record) const;
+	void publish(NotificationRecord const &record);
+	void publishWindow();
+	void clearWindowItem(int n);
+
+	std::vector<NotificationRecord> mStore;
+	int mHead = 0;
+	int mCount = 0;
+	int mActive = 0;
+	int mUnacknowledged = 0;
+	int mUnacknowledgedAlarms = 0; // active ones only, these raise the alarm
+	bool mAlarm = false;
+	bool mAlert = false;
+	quint32 mNextSeq = 0;
+	int const mMaxNotifications = 500;
+	int const mMaxWindow = 100;
+	int mWindowOffset = 0;
+	int mWindowCount = 20;
+	int mDebounce = 0;
+	int mFlapWindow = 300;
+	NotificationJournal *mJournal;
 
 	VeQItem *mNoficationsItem;
 	VeQItem *mNumberOfNotificationsItem;
 	VeQItem *mNumberOfActiveNotificationsItem;
+	VeQItem *mNumberOfStoredNotificationsItem;
 	VeQItem *mAlarmItem;
 	VeQItem *mAlertItem;
+	VeQItem *mHistoryCountItem;
+	VeQItem *mHistoryPageItem;
+	VeQItem *mWindowOffsetItem;
+	VeQItem *mWindowCountItem;
+	QList<VeQItem *> mWindowItems;
 };
 
 
@@ -69,3 +122,21 @@ public:
 private:
 	Notifications *mNotifications;
 };
+
+// Window/Offset and Window/Count, writable by the clients.
+class VeQItemNotificationWindow : public VeQItemAction {
+	Q_OBJECT
+
+public:
+	VeQItemNotificationWindow(Notifications *notifications, bool offset) :
+		VeQItemAction(),
+		mNotifications(notifications),
+		mOffset(offset)
+	{}
+
+	int setValue(const QVariant &value) override;
+
+private:
+	Notifications *mNotifications;
+	bool mOffset;
+};
@@ -0,0 +1,255 @@
+#include <QCoreApplication>
+#include <QDebug>
+
+#include "process_executor.hpp"
+
+ProcessJob::ProcessJob(int timeout, ProcessExecutor *executor) :
+	QObject(executor),
+	mTimeout(timeout)
+{
+	mTimer.setSingleShot(true);
+	connect(&mTimer, SIGNAL(timeout()), SLOT(onTimeout()));
+	mQueued.start();
+}
+
+void ProcessJob::addStep(QString const &cmd, QStringList const &args, QByteArray const &input)
+{
+	Step step;
+	step.cmd = cmd;
+	step.args = args;
+	step.input = input;
+	mSteps.append(step);
+}
+
+QString ProcessJob::description() const
+{
+	QStringList cmds;
+	for (Step const &step: mSteps)
+		cmds.append(step.cmd);
+	return cmds.join(" && ");
+}
+
+void ProcessJob::start()
+{
+	mStarted.start();
+	if (mTimeout > 0)
+		mTimer.start(mTimeout);
+	startStep();
+}
+
+void ProcessJob::startStep()
+{
+	if (mCurrentStep >= mSteps.count()) {
+		finish(mExitCode);
+		return;
+	}
+
+	Step const &step = mSteps[mCurrentStep];
+
+	mProc = new QProcess(this);
+	connect(mProc, SIGNAL(finished(int,QProcess::ExitStatus)), SLOT(onStepFinished(int,QProcess::ExitStatus)));
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+	connect(mProc, SIGNAL(errorOccurred(QProcess::ProcessError)), SLOT(onErrorOccurred(QProcess::ProcessError)));
+#else
+	connect(mProc, SIGNAL(error(QProcess::ProcessError)), SLOT(onErrorOccurred(QProcess::ProcessError)));
+#endif
+	mProc->start(step.cmd, step.args);
+
+	// Failing to start can be reported from within start(), the job is finished then.
+	if (mDone || !mProc)
+		return;
+
+	// Note: QProcess buffers the input till the process is started
+	if (!step.input.isEmpty())
+		mProc->write(step.input);
+	mProc->closeWriteChannel();
+}
+
+void ProcessJob::onStepFinished(int exitCode, QProcess::ExitStatus status)
+{
+	if (mDone)
+		return;
+
+	mOutput = mProc->readAllStandardOutput();
+	mExitCode = status == QProcess::NormalExit ? exitCode : -1;
+	mProc->deleteLater();
+	mProc = nullptr;
+
+	if (mStopOnError && mExitCode != 0) {
+		finish(mExitCode);
+		return;
+	}
+
+	mCurrentStep++;
+	startStep();
+}
+
+void ProcessJob::onErrorOccurred(QProcess::ProcessError error)
+{
+	// A crash or a kill also results in finished, only failing to start doesn't.
+	if (mDone || error != QProcess::FailedToStart)
+		return;
+
+	qWarning() << "[ProcessExecutor] failed to start" << mSteps[mCurrentStep].cmd;
+	mProc->deleteLater();
+	mProc = nullptr;
+	finish(-1);
+}
+
+void ProcessJob::onTimeout()
+{
+	if (mDone)
+		return;
+
+	qWarning() << "[ProcessExecutor]" << description() << "timed out after" << mTimeout << "ms";
+	mTimedOut = true;
+	if (mProc) {
+		// Don't block on the killed process, the executor outlives this job.
+		mProc->disconnect(this);
+		mProc->setParent(parent());
+		mProc->kill();
+		connect(mProc, SIGNAL(finished(int,QProcess::ExitStatus)), mProc, SLOT(deleteLater()));
+		mProc = nullptr;
+	}
+	finish(-1);
+}
+
+void ProcessJob::finish(int exitCode)
+{
+	mDone = true;
+	mTimer.stop();
+	mExitCode = exitCode;
+
+	static_cast<ProcessExecutor *>(parent())->jobFinished(this, mStarted.elapsed());
+	emit finished(exitCode);
+	deleteLater();
+}
+
+ProcessExecutor *ProcessExecutor::instance()
+{
+	static ProcessExecutor *executor = new ProcessExecutor(qApp);
+	return executor;
+}
+
+ProcessExecutor::ProcessExecutor(QObject *parent) :
+	QObject(parent)
+{
+}
+
+ProcessJob *ProcessExecutor::createJob(int timeout)
+{
+	ProcessJob *job = new ProcessJob(timeout, this);
+	enqueue(job);
+	return job;
+}
+
+ProcessJob *ProcessExecutor::run(QString const &cmd, QStringList const &args, int timeout)
+{
+	ProcessJob *job = createJob(timeout);
+	job->addStep(cmd, args);
+	return job;
+}
+
+// The job is only started from the event loop, so the caller can still add steps,
+// set the group and connect to the finished signal.
+void ProcessExecutor::enqueue(ProcessJob *job)
+{
+	mQueue.append(job);
+	updateItems();
+	scheduleLater();
+}
+
+void ProcessExecutor::scheduleLater()
+{
+	if (mScheduled)
+		return;
+	mScheduled = true;
+	QTimer::singleShot(0, this, SLOT(schedule()));
+}
+
+bool ProcessExecutor::groupRunning(QString const &group) const
+{
+	if (group.isEmpty())
+		return false;
+
+	for (ProcessJob *job: mRunning) {
+		if (job->group() == group)
+			return true;
+	}
+	return false;
+}
+
+void ProcessExecutor::schedule()
+{
+	mScheduled = false;
+
+	for (int n = 0; n < mQueue.count() && mRunning.count() < mMaxRunning; ) {
+		ProcessJob *job = mQueue[n];
+
+		// Keep the order within a group, so skip all later jobs of that group as well.
+		bool blocked = groupRunning(job->group());
+		for (int i = 0; !blocked && i < n; i++)
+			blocked = !job->group().isEmpty() && mQueue[i]->group() == job->group();
+		if (blocked) {
+			n++;
+			continue;
+		}
+
+		mQueue.removeAt(n);
+		mRunning.append(job);
+		jobStarted(job, job->mQueued.elapsed());
+		job->start();
+	}
+
+	updateItems();
+}
+
+void ProcessExecutor::jobStarted(ProcessJob *job, qint64 latency)
+{
+	Q_UNUSED(job);
+
+	mStartedCount++;
+	mLastLatency = latency;
+	if (latency > mMaxLatency)
+		mMaxLatency = latency;
+}
+
+void ProcessExecutor::jobFinished(ProcessJob *job, qint64 duration)
+{
+	mRunning.removeOne(job);
+
+	if (job->timedOut())
+		mTimedOutCount++;
+	else if (job->exitCode() != 0)
+		mFailedCount++;
+
+	mLastDuration = duration;
+	if (duration > mMaxDuration)
+		mMaxDuration = duration;
+
+	updateItems();
+	if (!mQueue.isEmpty())
+		scheduleLater();
+}
+
+void ProcessExecutor::publish(VeQItem *parentItem)
+{
+	mItem = parentItem->itemGetOrCreate("Debug/Processes");
+	updateItems();
+}
+
+void ProcessExecutor::updateItems()
+{
+	if (!mItem)
+		return;
+
+	mItem->itemGetOrCreateAndProduce("Queued", mQueue.count());
+	mItem->itemGetOrCreateAndProduce("Running", mRunning.count());
+	mItem->itemGetOrCreateAndProduce("Started", mStartedCount);
+	mItem->itemGetOrCreateAndProduce("Failed", mFailedCount);
+	mItem->itemGetOrCreateAndProduce("TimedOut", mTimedOutCount);
+	mItem->itemGetOrCreateAndProduce("Latency/Last", mLastLatency);
+	mItem->itemGetOrCreateAndProduce("Latency/Max", mMaxLatency);
+	mItem->itemGetOrCreateAndProduce("Duration/Last", mLastDuration);
+	mItem->itemGetOrCreateAndProduce("Duration/Max", mMaxDuration);
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QProcess>
+#include <QStringList>
+#include <QTimer>
+
+#include <veutil/qt/ve_qitem.hpp>
+
+class ProcessExecutor;
+
+// A job runs one or more commands in order, e.g. resize the rootfs and then
+// change the password. finished() is emitted with the exit code of the last
+// command, or -1 if a command failed to start or the job timed out. The job
+// deletes itself after finished() is emitted.
+class ProcessJob : public QObject
+{
+	Q_OBJECT
+
+public:
+	void addStep(QString const &cmd, QStringList const &args = QStringList(), QByteArray const &input = QByteArray());
+	void setTimeout(int msec) { mTimeout = msec; }
+	// Jobs in the same group are run one after another, e.g. firewall rules.
+	void setGroup(QString const &group) { mGroup = group; }
+	// Don't run the remaining commands once one of them failed.
+	void setStopOnError(bool stop) { mStopOnError = stop; }
+
+	QString group() const { return mGroup; }
+	QString description() const;
+	int exitCode() const { return mExitCode; }
+	bool timedOut() const { return mTimedOut; }
+	QByteArray output() const { return mOutput; }
+
+signals:
+	void finished(int exitCode);
+
+private slots:
+	void onStepFinished(int exitCode, QProcess::ExitStatus status);
+	void onErrorOccurred(QProcess::ProcessError error);
+	void onTimeout();
+
+private:
+	struct Step {
+		QString cmd;
+		QStringList args;
+		QByteArray input;
+	};
+
+	ProcessJob(int timeout, ProcessExecutor *executor);
+	void start();
+	void startStep();
+	void finish(int exitCode);
+
+	QList<Step> mSteps;
+	int mCurrentStep = 0;
+	int mTimeout;
+	QString mGroup;
+	QProcess *mProc = nullptr;
+	QTimer mTimer;
+	QElapsedTimer mQueued;
+	QElapsedTimer mStarted;
+	QByteArray mOutput;
+	int mExitCode = -1;
+	bool mTimedOut = false;
+	bool mDone = false;
+	bool mStopOnError = false;
+
+	friend class ProcessExecutor;
+};
+
+// Runs child processes without blocking the event loop, since alarms are handled
+// by the same thread. The number of concurrently running jobs is bounded, the
+// others are queued. The queue depth and latency are exported in Debug/Processes.
+class ProcessExecutor : public QObject
+{
+	Q_OBJECT
+
+public:
+	static ProcessExecutor *instance();
+
+	ProcessJob *createJob(int timeout = mDefaultTimeout);
+	ProcessJob *run(QString const &cmd, QStringList const &args = QStringList(), int timeout = mDefaultTimeout);
+	void setMaxRunning(int maxRunning) { mMaxRunning = maxRunning; }
+	void publish(VeQItem *parentItem);
+
+	static int const mDefaultTimeout = 30000;
+
+private slots:
+	void schedule();
+
+private:
+	ProcessExecutor(QObject *parent = 0);
+	void enqueue(ProcessJob *job);
+	void jobStarted(ProcessJob *job, qint64 latency);
+	void jobFinished(ProcessJob *job, qint64 duration);
+	bool groupRunning(QString const &group) const;
+	void scheduleLater();
+	void updateItems();
+
+	QList<ProcessJob *> mQueue;
+	QList<ProcessJob *> mRunning;
+	int mMaxRunning = 4;
+	bool mScheduled = false;
+
+	quint64 mStartedCount = 0;
+	quint64 mFailedCount = 0;
+	quint64 mTimedOutCount = 0;
+	qint64 mLastLatency = 0;
+	qint64 mMaxLatency = 0;
+	qint64 mLastDuration = 0;
+	qint64 mMaxDuration = 0;
+	VeQItem *mItem = nullptr;
+
+	friend class ProcessJob;
+};
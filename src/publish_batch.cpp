@@ -0,0 +1,89 @@
+#include <QTimer>
+
+#include "publish_batch.hpp"
+
+PublishBatch::PublishBatch(VeQItem *root) :
+	mQueue(PublishQueue::forRoot(root))
+{
+	mQueue->begin();
+}
+
+PublishBatch::~PublishBatch()
+{
+	mQueue->end();
+}
+
+void PublishBatch::produce(VeQItem *item, QVariant const &value)
+{
+	mQueue->add(item, value);
+}
+
+VeQItem *PublishBatch::produce(VeQItem *parent, QString const &id, QVariant const &value)
+{
+	VeQItem *item = parent->itemGetOrCreate(id);
+	mQueue->add(item, value);
+	return item;
+}
+
+QVariant PublishBatch::value(VeQItem *item) const
+{
+	QVariant ret;
+	if (!mQueue->pending(item, &ret))
+		ret = item->getLocalValue();
+	return ret;
+}
+
+PublishQueue *PublishQueue::forRoot(VeQItem *root)
+{
+	PublishQueue *queue = root->findChild<PublishQueue *>(QString(), Qt::FindDirectChildrenOnly);
+	if (!queue)
+		queue = new PublishQueue(root);
+	return queue;
+}
+
+void PublishQueue::add(VeQItem *item, QVariant const &value)
+{
+	auto it = mIndex.constFind(item);
+	if (it != mIndex.constEnd()) {
+		mEntries[it.value()].value = value;
+		return;
+	}
+
+	mIndex.insert(item, mEntries.size());
+	mEntries.append({item, value});
+}
+
+bool PublishQueue::pending(VeQItem *item, QVariant *value) const
+{
+	auto it = mIndex.constFind(item);
+	if (it == mIndex.constEnd())
+		return false;
+
+	*value = mEntries[it.value()].value;
+	return true;
+}
+
+// The last batch of the tick ended, publish when the event loop continues, so the
+// batches of other handlers of the same event are included.
+void PublishQueue::end()
+{
+	if (--mDepth > 0 || mScheduled || mEntries.isEmpty())
+		return;
+
+	mScheduled = true;
+	QTimer::singleShot(0, this, SLOT(flush()));
+}
+
+void PublishQueue::flush()
+{
+	QVector<Entry> entries;
+
+	mScheduled = false;
+	entries.swap(mEntries);
+	mIndex.clear();
+
+	for (Entry const &entry: entries) {
+		if (entry.item)
+			entry.item->produceValue(entry.value);
+	}
+}
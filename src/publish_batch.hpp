@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QVariant>
+#include <QVector>
+
+#include <veutil/qt/ve_qitem.hpp>
+
+class PublishQueue;
+
+/*
+ * Collects values produced together, so they are published at once when the event loop
+ * continues, e.g. all items of a notification. Clients never see a partially updated
+ * set and, since they are produced in a single pass, the exporter sends them as one
+ * change. Writing an item twice in the same tick only publishes the last value. Values
+ * equal to the current one are produced as well, like with produceValue().
+ *
+ *	PublishBatch batch(mService);
+ *	batch.produce(mService, "Firmware/State", 2);
+ *
+ * Since the values are only set when the tick ends, getLocalValue() returns the old one
+ * until then, use value() instead when the pending one matters.
+ */
+class PublishBatch
+{
+public:
+	explicit PublishBatch(VeQItem *root);
+	~PublishBatch();
+
+	void produce(VeQItem *item, QVariant const &value);
+	VeQItem *produce(VeQItem *parent, QString const &id, QVariant const &value);
+	QVariant value(VeQItem *item) const;
+
+private:
+	Q_DISABLE_COPY(PublishBatch)
+
+	PublishQueue *mQueue;
+};
+
+// The values pending for the items below root, owned by the root item.
+class PublishQueue : public QObject
+{
+	Q_OBJECT
+
+public:
+	static PublishQueue *forRoot(VeQItem *root);
+
+	void add(VeQItem *item, QVariant const &value);
+	bool pending(VeQItem *item, QVariant *value) const;
+	void begin() { mDepth++; }
+	void end();
+
+private slots:
+	void flush();
+
+private:
+	explicit PublishQueue(VeQItem *root) : QObject(root) {}
+
+	struct Entry {
+		QPointer<VeQItem> item;
+		QVariant value;
+	};
+
+	QVector<Entry> mEntries;
+	QHash<VeQItem *, int> mIndex;
+	int mDepth = 0;
+	bool mScheduled = false;
+};
@@ -1,3 +1,4 @@
+#include "alarm_stats.hpp"
 #include "relay.hpp"
 
 Relay::Relay(QString relayPath, Notifications *notifications, QObject *parent) :
@@ -53,9 +54,14 @@ void Relay::setRelayOn(bool on)
  */
 void Relay::setHwState(bool closed)
 {
-	if (!mRelayState->getValue().isValid())
+	if (!mRelayState->getValue().isValid()) {
+		if (AlarmStats::instance())
+			AlarmStats::instance()->relayWriteSkipped();
 		return;
+	}
 	mRelayState->setValue(closed ? 1 : 0);
+	if (mIntendedState && AlarmStats::instance())
+		AlarmStats::instance()->relaySwitched();
 }
 
 void Relay::alarmChanged()
@@ -3,6 +3,7 @@
 #include "application.hpp"
 #include "json.h"
 #include "security_profiles.hpp"
+#include "supervise_control.hpp"
 
 // The security level can be lowered to allow convenien, but less
 // secure features.
@@ -41,6 +42,14 @@ enum NetworkConfigEvent {
 	NETWORK_CONFIG_SECURITY_PROFILE_CHANGED,
 };
 
+// The result of the last SetRootPassword, which is applied asynchronously.
+enum RootPasswordState {
+	ROOT_PASSWORD_IDLE,
+	ROOT_PASSWORD_CHANGING,
+	ROOT_PASSWORD_CHANGED,
+	ROOT_PASSWORD_FAILED
+};
+
 SecurityApi::SecurityApi(VeQItem *pltService, VeQItemSettings *settings) :
 	VeQItemAction()
 {
@@ -51,6 +60,7 @@ SecurityApi::SecurityApi(VeQItem *pltService, VeQItemSettings *settings) :
 	mSecurityProfile->getValue();
 
 	mPendingServiceRestart = pltService->itemGetOrCreateAndProduce("Network/ConfigChanged", NETWORK_CONFIG_NO_EVENT);
+	mRootPasswordState = pltService->itemGetOrCreateAndProduce("Security/RootPasswordState", ROOT_PASSWORD_IDLE);
 };
 
 int SecurityApi::setValue(const QVariant &value)
@@ -102,7 +112,9 @@ int SecurityApi::setValue(const QVariant &value)
 
 	password = map.value("SetRootPassword");
 	if (password.isValid()) {
-		ok = Application::setRootPassword(password.toString());
+		ProcessJob *job = Application::setRootPassword(password.toString());
+		connect(job, SIGNAL(finished(int)), SLOT(onRootPasswordChanged(int)));
+		mRootPasswordState->produceValue(ROOT_PASSWORD_CHANGING);
 	}
 
 	securityProfile = map.value("SetSecurityProfile");
@@ -194,12 +206,24 @@ void SecurityApi::restartWebserver()
 	// This is delayed, so hopefully the users are already informed that the
 	// services will temporarily be down.
 	qCritical() << "[Api] restarting the webserver";
-	Application::spawn("svc", QStringList() << "-t" << "/service/nginx/");
+	SuperviseControl::send("/service/nginx", "t");
 
 	QTimer *timer = qobject_cast<QTimer *>(sender());
 	delete timer;
 }
 
+// Changing the root password is not waited for, clients can follow Security/RootPasswordState.
+void SecurityApi::onRootPasswordChanged(int exitCode)
+{
+	if (exitCode == 0) {
+		qWarning() << "Root password changed";
+		mRootPasswordState->produceValue(ROOT_PASSWORD_CHANGED);
+	} else {
+		qCritical() << "Changing password failed";
+		mRootPasswordState->produceValue(ROOT_PASSWORD_FAILED);
+	}
+}
+
 void SecurityApi::resetConfigEvent()
 {
 	mPendingServiceRestart->produceValue(NETWORK_CONFIG_NO_EVENT);
@@ -223,8 +247,8 @@ VrmTunnelSetup::VrmTunnelSetup(VeQItem *pltService, VeQItemSettings *settings,
 	mVncEnabled = settings->root()->itemGetOrCreate("Settings/System/VncLocal");
 	mVncEnabled->getValueAndChanges(this, SLOT(checkVrmTunnel()));
 
-	// Look for EV chargers
-	connect(venusServices, SIGNAL(found(VenusService*)), SLOT(onServiceFound(VenusService*)));
+	// Look for EV chargers, including the ones already found before this was created.
+	venusServices->subscribe(VenusServiceType::EV_CHARGER, this, "onEvChargerFound");
 
 	// Large image services
 	if (serviceExists("node-red-venus")) {
@@ -274,13 +298,12 @@ setTunnel:
 	mPltService->itemGetOrCreateAndProduce("ConnectVrmTunnel", doTunnel);
 }
 
-void VrmTunnelSetup::onServiceFound(VenusService *service)
+void VrmTunnelSetup::onEvChargerFound(VenusService *service)
 {
-	// qDebug() << service->getName() << int(service->getType());
-	if (service->getType() == VenusServiceType::EV_CHARGER) {
-		mEvChargerFound = true;
-		checkVrmTunnel();
-	}
+	Q_UNUSED(service);
+
+	mEvChargerFound = true;
+	checkVrmTunnel();
 }
 
 SecurityProfiles::SecurityProfiles(VeQItem *pltService, VeQItemSettings *settings,
@@ -294,11 +317,10 @@ SecurityProfiles::SecurityProfiles(VeQItem *pltService, VeQItemSettings *setting
 	pltService->itemGetOrCreate("Security")->itemAddChild("Api", new SecurityApi(pltService, settings));
 
 	mTunnelSetup = new VrmTunnelSetup(pltService, settings, venusServices, this);
+	mFirewall = new FirewallManager(pltService, this);
 
 	// handle the VNC websocket for gui-v1 remote console on LAN.
-	mVncWebsocket = new DaemonToolsService("/service/websockify-c");
-	mVncWebsocket->setSveCtlArgs(QStringList() << "-s" << "websockify-c");
-	mVncWebsocket->setRestart(false);
+	mVncWebsocket = new TemplatedService("websockify-c", this);
 
 	// NOTE: the setting is added system-wide in /etc/venus/settings, since several
 	// programs / scripts depend on it.
@@ -318,16 +340,14 @@ SecurityProfiles::SecurityProfiles(VeQItem *pltService, VeQItemSettings *setting
 	checkVncWebsocket();
 
 	enableMqttOnLan(false); // Disable LAN socket access by default, unless explicitly enabled.
-	mFlashMq = new DaemonToolsService("/service/flashmq", this);
-	mFlashMq->setSveCtlArgs(QStringList() << "-s" << "flashmq");
+	mFlashMq = new TemplatedService("flashmq", this);
 
 	// Since gui-v2 ws requires it, always make the wss mqtt socket available.
 	// The webserver will block access / instruct the user to set a Security Profile if not yet done.
 	mFlashMq->install();
 
 	// RPC commands are only needed by full access. Mqtt on LAN perhaps as well, but not gui-v2.
-	mMqttRpc = new DaemonToolsService("/service/mqtt-rpc", this);
-	mMqttRpc->setSveCtlArgs(QStringList() << "-s" << "mqtt-rpc");
+	mMqttRpc = new TemplatedService("mqtt-rpc", this);
 	mMqttRpc->install();
 }
 
@@ -391,7 +411,7 @@ void SecurityProfiles::enableMqttBridge(bool configChanged)
 
 	if (configChanged && mFlashMq) {
 		qDebug() << "flashmq config changed";
-		system("killall -HUP flashmq");
+		Application::run("killall", QStringList() << "-HUP" << "flashmq");
 	}
 }
 
@@ -456,10 +476,10 @@ void SecurityProfiles::enableMqttOnLan(bool enabled)
 	// 1883: encrypted normal socket
 	if (enabled) {
 		qWarning() << "[Firewall] Allow local MQTT over SSL, port 8883";
-		Application::run("firewall", QStringList() << "allow" << "tcp" << "8883");
+		mFirewall->setAllowed(8883, true);
 	} else {
 		qWarning() << "[Firewall] Disallow local MQTT over SSL, port 8883";
-		Application::run("firewall", QStringList() << "deny" << "tcp" << "8883");
+		mFirewall->setAllowed(8883, false);
 	}
 }
 
@@ -473,12 +493,12 @@ void SecurityProfiles::enableMqttOnLanInsecure(bool enabled)
 	// 9001: plain websocket
 	if (enabled) {
 		qWarning() << "[Firewall] Allow insecure access to MQTT, port 1883 / 9001";
-		Application::run("firewall", QStringList() << "allow" << "tcp" << "1883");
-		Application::run("firewall", QStringList() << "allow" << "tcp" << "9001");
+		mFirewall->setAllowed(1883, true);
+		mFirewall->setAllowed(9001, true);
 	} else {
 		qWarning() << "[Firewall] Disallow insecure access to MQTT, port 1883 / 9001";
-		Application::run("firewall", QStringList() << "deny" << "tcp" << "1883");
-		Application::run("firewall", QStringList() << "deny" << "tcp" << "9001");
+		mFirewall->setAllowed(1883, false);
+		mFirewall->setAllowed(9001, false);
 	}
 }
 
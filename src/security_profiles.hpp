@@ -7,6 +7,8 @@
 #include <veutil/qt/ve_qitem_utils.hpp>
 #include <veutil/qt/ve_qitems_dbus.hpp>
 
+#include "firewall_manager.hpp"
+#include "service_templates.hpp"
 #include "venus_services.hpp"
 
 class VeQItemMqttBridgeRegistrar: public VeQItemAction {
@@ -74,11 +76,13 @@ public:
 private slots:
 	void restartWebserver();
 	void resetConfigEvent();
+	void onRootPasswordChanged(int exitCode);
 
 private:
 	VeQItem *mVrmLoggerHttpsEnabled;
 	VeQItem *mSecurityProfile;
 	VeQItem *mPendingServiceRestart;
+	VeQItem *mRootPasswordState;
 };
 
 class VrmTunnelSetup : public QObject
@@ -91,7 +95,7 @@ public:
 
 private slots:
 	void checkVrmTunnel();
-	void onServiceFound(VenusService *service);
+	void onEvChargerFound(VenusService *service);
 
 private:
 	void onSecurityProfileChanged(QVariant const &var);
@@ -140,12 +144,13 @@ private:
 	QVariant mMqttOnLan;
 	QVariant mMqttOnLanInsecure;
 
-	DaemonToolsService *mFlashMq = nullptr;
-	DaemonToolsService *mMqttRpc = nullptr;
+	TemplatedService *mFlashMq = nullptr;
+	TemplatedService *mMqttRpc = nullptr;
 
 	VrmTunnelSetup *mTunnelSetup;
+	FirewallManager *mFirewall;
 
-	DaemonToolsService *mVncWebsocket = nullptr;
+	TemplatedService *mVncWebsocket = nullptr;
 	VeQItem *mVncEnabled = nullptr;
 
 	VeQItemMqttBridgeRegistrar *mMqttBridgeRegistrar;
@@ -0,0 +1,517 @@
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QThread>
+
+#include "process_executor.hpp"
+#include "service_templates.hpp"
+#include "supervise_control.hpp"
+
+QString const ServiceTemplates::serviceDir = "/run/service";
+QString const ServiceTemplates::permanentServiceDir = "/opt/victronenergy/service";
+// Note: like svectl, the configs are always taken from the default location, also for -t
+QString const ServiceTemplates::configDir = "/opt/victronenergy/service-templates/conf";
+
+ServiceTemplates *ServiceTemplates::instance()
+{
+	static ServiceTemplates templates;
+	return &templates;
+}
+
+ServiceTemplates::ServiceTemplates(QString const &templateDir) :
+	mTemplateDir(templateDir)
+{
+}
+
+bool ServiceTemplates::error(QString const &message)
+{
+	mLastError = message;
+	qCritical() << "[ServiceTemplates]" << message;
+	return false;
+}
+
+QStringList ServiceTemplates::available() const
+{
+	QStringList ret;
+	QDir dir(configDir);
+	for (QString const &conf: dir.entryList(QStringList() << "*.conf", QDir::Files, QDir::Name))
+		ret.append(conf.left(conf.length() - 5));
+	return ret;
+}
+
+bool ServiceTemplates::parseConfig(QString const &fileName, Template &tmpl, QStringList &included)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return error("The config file " + fileName + " doesn't exists");
+
+	while (!file.atEnd()) {
+		QString line = QString::fromUtf8(file.readLine());
+		int comment = line.indexOf('#');
+		if (comment >= 0)
+			line.truncate(comment);
+		line = line.trimmed();
+		if (line.isEmpty())
+			continue;
+
+		if (line.startsWith("include ")) {
+			QString inc = configDir + "/" + line.mid(8).trimmed();
+			if (included.contains(inc))
+				return error(inc + " is included multiple times!");
+			included.append(inc);
+			if (!parseConfig(inc, tmpl, included))
+				return false;
+			continue;
+		}
+
+		int eq = line.indexOf('=');
+		QString var = line.left(eq).trimmed();
+		QString value = eq < 0 ? QString() : line.mid(eq + 1).trimmed();
+
+		if (var == "PARAM") {
+			tmpl.params.append(value.section(':', 0, 0));
+			tmpl.paramHelp.append(value);
+		} else if (var == "SERVICE_EXT") {
+			tmpl.serviceExt = value;
+		} else {
+			return error("unknown config option " + var + " in " + fileName);
+		}
+	}
+
+	return true;
+}
+
+bool ServiceTemplates::loadTree(QString const &dir, QString const &prefix, QList<Entry> &entries)
+{
+	QDir src(dir);
+	QFileInfoList const infos = src.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System, QDir::Name);
+
+	for (QFileInfo const &info: infos) {
+		Entry entry;
+		entry.path = prefix + info.fileName();
+		entry.permissions = info.permissions();
+
+		if (info.isSymLink()) {
+			char target[PATH_MAX];
+			ssize_t len = readlink(QFile::encodeName(info.filePath()).constData(), target, sizeof(target) - 1);
+			if (len < 0)
+				return error("unable to read link " + info.filePath());
+			entry.type = Entry::LINK;
+			entry.data = QByteArray(target, len);
+			entries.append(entry);
+		} else if (info.isDir()) {
+			// A template should not contain state, but don't copy it if it does.
+			if (info.fileName() == "supervise")
+				continue;
+			entry.type = Entry::DIR;
+			entries.append(entry);
+			if (!loadTree(info.filePath(), entry.path + "/", entries))
+				return false;
+		} else {
+			QFile file(info.filePath());
+			if (!file.open(QIODevice::ReadOnly))
+				return error("unable to read " + info.filePath());
+			entry.type = Entry::FILE;
+			entry.data = file.readAll();
+			entries.append(entry);
+		}
+	}
+
+	return true;
+}
+
+ServiceTemplates::Template const *ServiceTemplates::compiled(QString const &service)
+{
+	QHash<QString, Template>::const_iterator it = mTemplates.constFind(service);
+	if (it != mTemplates.constEnd())
+		return &it.value();
+
+	QString src = mTemplateDir + "/" + service;
+	if (!QFileInfo(src).isDir()) {
+		error("The template directory " + src + " doesn't exist");
+		return nullptr;
+	}
+
+	Template tmpl;
+	QStringList included;
+	if (!parseConfig(configDir + "/" + service + ".conf", tmpl, included))
+		return nullptr;
+	if (!loadTree(src, QString(), tmpl.entries))
+		return nullptr;
+
+	return &mTemplates.insert(service, tmpl).value();
+}
+
+bool ServiceTemplates::checkParams(Template const &tmpl, Params const &params)
+{
+	QStringList defined;
+	for (QPair<QString, QString> const &param: params)
+		defined.append(param.first);
+
+	for (QString const &param: tmpl.params) {
+		if (!defined.contains(param))
+			return error(param + " is needed, but is not defined, -D " + param + "=...");
+	}
+
+	for (QString const &var: defined) {
+		if (!tmpl.params.contains(var))
+			return error(var + " is defined, but is not valid");
+	}
+
+	return true;
+}
+
+// Like sed -e 's:var:value:' for every parameter, so the first occurrence per line.
+QByteArray ServiceTemplates::substitute(QByteArray const &data, Params const &params)
+{
+	if (params.isEmpty())
+		return data;
+
+	QList<QByteArray> lines = data.split('\n');
+	for (QByteArray &line: lines) {
+		for (QPair<QString, QString> const &param: params) {
+			QByteArray var = param.first.toUtf8();
+			int pos = line.indexOf(var);
+			if (pos >= 0)
+				line.replace(pos, var.size(), param.second.toUtf8());
+		}
+	}
+
+	QByteArray ret;
+	for (int n = 0; n < lines.count(); n++) {
+		if (n)
+			ret.append('\n');
+		ret.append(lines[n]);
+	}
+	return ret;
+}
+
+QString ServiceTemplates::serviceDirName(QString const &service, Params const &params)
+{
+	Template const *tmpl = compiled(service);
+	if (!tmpl || !checkParams(*tmpl, params))
+		return QString();
+
+	return service + QString::fromUtf8(substitute(tmpl->serviceExt.toUtf8(), params));
+}
+
+bool ServiceTemplates::createServiceDir(Template const &tmpl, QString const &target, Params const &params)
+{
+	// Check if service already exists
+	if (QFileInfo(target).isDir())
+		return true;
+
+	QFileInfo info(target);
+	QString tmp = info.absolutePath() + "/." + info.fileName() + ".tmp" + QString::number(getpid());
+
+	QDir(tmp).removeRecursively();
+	if (!QDir().mkpath(tmp))
+		return error("unable to create " + tmp);
+
+	for (Entry const &entry: tmpl.entries) {
+		QString path = tmp + "/" + entry.path;
+		bool ok = true;
+
+		switch (entry.type) {
+		case Entry::DIR:
+			ok = QDir().mkdir(path);
+			break;
+		case Entry::LINK:
+			ok = symlink(entry.data.constData(), QFile::encodeName(path).constData()) == 0;
+			break;
+		case Entry::FILE:
+		{
+			// patch run files for e.g. the tty or CAN-bus device
+			bool patch = entry.path == "run" || entry.path == "log/run";
+			QFile file(path);
+			ok = file.open(QIODevice::WriteOnly) &&
+					file.write(patch ? substitute(entry.data, params) : entry.data) >= 0;
+			file.close();
+			break;
+		}
+		}
+
+		if (ok && entry.type != Entry::LINK)
+			ok = QFile::setPermissions(path, entry.permissions);
+
+		if (!ok) {
+			QDir(tmp).removeRecursively();
+			return error("unable to create " + path);
+		}
+	}
+
+	if (rename(QFile::encodeName(tmp).constData(), QFile::encodeName(target).constData()) != 0) {
+		int err = errno;
+		QDir(tmp).removeRecursively();
+		// Created by someone else in the meantime
+		if (QFileInfo(target).isDir())
+			return true;
+		return error("unable to rename " + tmp + " to " + target + ": " + strerror(err));
+	}
+
+	return true;
+}
+
+// Like ln -sf, but the link is replaced atomically. The temporary link starts with a dot,
+// so svscan doesn't start a service for it.
+bool ServiceTemplates::link(QString const &target, QString const &linkName)
+{
+	QFileInfo info(linkName);
+	QString tmp = info.absolutePath() + "/." + info.fileName() + ".tmp" + QString::number(getpid());
+
+	unlink(QFile::encodeName(tmp).constData());
+	if (symlink(QFile::encodeName(target).constData(), QFile::encodeName(tmp).constData()) != 0 ||
+			rename(QFile::encodeName(tmp).constData(), QFile::encodeName(linkName).constData()) != 0) {
+		unlink(QFile::encodeName(tmp).constData());
+		return error("unable to link " + linkName + " to " + target);
+	}
+
+	return true;
+}
+
+// By default only a service is created on the RAM-disk, since Venus OS uses a readonly
+// rootfs. After a reboot, they are no longer present and will be re-added by serial-starter,
+// venus-platform etc. Permanent adds them to the rootfs as well, which must be writable.
+//
+// Note: svscan is not signalled to rescan, see svrescan.
+bool ServiceTemplates::install(QString const &service, Params const &params, bool permanent)
+{
+	Template const *tmpl = compiled(service);
+	if (!tmpl || !checkParams(*tmpl, params))
+		return false;
+
+	QString dirName = serviceDirName(service, params);
+
+	if (permanent && !createServiceDir(*tmpl, permanentServiceDir + "/" + dirName, params))
+		return error("Adding permanent service failed. Forgot to run /opt/victronenergy/swupdate-scripts/resize2fs.sh ?");
+
+	QString target = serviceDir + "/" + dirName;
+	if (!createServiceDir(*tmpl, target, params))
+		return false;
+
+	// symlink into /service for svscan to find
+	return link(target, "/service/" + dirName);
+}
+
+bool ServiceTemplates::remove(QString const &service, Params const &params)
+{
+	QString dirName = serviceDirName(service, params);
+	if (dirName.isEmpty())
+		return false;
+
+	QString svc = "/service/" + dirName;
+	QString target = serviceDir + "/" + dirName;
+	QFileInfo svcInfo(svc);
+
+	if (svcInfo.isSymLink())
+		QFile::remove(svc);
+	else if (svcInfo.exists())
+		QDir(svc).removeRecursively();
+
+	if (QFileInfo(target).exists()) {
+		SuperviseControl::send(target, "dx");
+		SuperviseControl::send(target + "/log", "dx");
+		QDir(target).removeRecursively();
+	}
+
+	QString perm = permanentServiceDir + "/" + dirName;
+	if (QFileInfo(perm).exists())
+		QDir(perm).removeRecursively();
+
+	return true;
+}
+
+static void usage(char const *name)
+{
+	printf("%s -- install or remove services on a Venus Device.\n\n", name);
+	printf("Services on Venus are typically supervised by daemontools. For devices which are\n"
+		   "discovered later these service can be created once found. Typically they need some\n"
+		   "parameter to be change, e.g. the tty or network interface. This reads which\n"
+		   "parameters to change from /opt/victronenergy/service-templates/conf and creates\n"
+		   "the corresponding service from /opt/victronenergy/service-templates/[service] in\n"
+		   "/run/service after changing the parameters. Optionally it can be created in the\n"
+		   "rootfs as well, so it will survive a reboot, but in normal cases the rootfs is\n"
+		   "readonly.\n\n");
+	printf("Options:\n"
+		   "-D var=value  set service dependend parameters\n"
+		   "-h            this help\n"
+		   "-l            list the avialable services\n"
+		   "-p            permanently install the service in the rootfs as well.\n"
+		   "              This requires a writable rootfs!\n"
+		   "-r            remove the service\n"
+		   "-s            the service to be installed, see -l\n"
+		   "-t            the template dir to be used, /opt/victronenergy/service-templates by default\n"
+		   "-w            wait for a service dir to be supervised when adding a service\n");
+}
+
+// The svectl command line, svectl itself execs this.
+int ServiceTemplates::cli(int argc, char *argv[])
+{
+	QString templateDir = "/opt/victronenergy/service-templates";
+	QString service;
+	Params params;
+	bool permanent = false;
+	bool remove = false;
+	bool wait = false;
+	int arg;
+
+	while ((arg = getopt(argc, argv, "hD:lprs:t:w")) != -1) {
+		switch (arg) {
+		case 'D':
+		{
+			QString def = QString::fromLocal8Bit(optarg);
+			int eq = def.indexOf('=');
+			params.append(qMakePair(def.left(eq), def.mid(eq + 1)));
+			break;
+		}
+		case 'l':
+			printf("Available services:\n");
+			for (QString const &name: ServiceTemplates().available())
+				printf(" - %s\n", qPrintable(name));
+			return EXIT_SUCCESS;
+		case 'p':
+			permanent = true;
+			break;
+		case 'r':
+			remove = true;
+			break;
+		case 's':
+			service = QString::fromLocal8Bit(optarg);
+			break;
+		case 't':
+			templateDir = QString::fromLocal8Bit(optarg);
+			break;
+		case 'w':
+			wait = true;
+			break;
+		default:
+			usage(argv[0]);
+			return EXIT_SUCCESS;
+		}
+	}
+
+	if (service.isEmpty()) {
+		printf("Service is not set, see -s\n");
+		usage(argv[0]);
+		return EXIT_SUCCESS;
+	}
+
+	ServiceTemplates templates(templateDir);
+
+	if (remove)
+		return templates.remove(service, params) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	if (!templates.install(service, params, permanent)) {
+		fprintf(stderr, "%s\n", qPrintable(templates.lastError()));
+		return EXIT_FAILURE;
+	}
+
+	QString svc = "/service/" + templates.serviceDirName(service, params);
+	printf("Added service: %s\n", qPrintable(svc));
+	if (QFileInfo(svc + "/down").exists())
+		printf("NOTE: the service (%s) is still down.\n", qPrintable(svc));
+
+	// This is venus specific, with a stock daemontools, this can take up to 5 seconds.
+	// In venus daemontools is patched, so it can be signalled to scan. Since svscan
+	// will be killed in an unpatched case, make sure to only signal it when supported.
+	QString svrescan = QStandardPaths::findExecutable("svrescan");
+	if (!svrescan.isEmpty())
+		QProcess::execute(svrescan, QStringList());
+
+	if (wait) {
+		for (int n = 0; n < 70; n++) {
+			QThread::msleep(100);
+			if (QFileInfo(svc + "/supervise/control").exists() && QFileInfo(svc + "/log/supervise/control").exists())
+				break;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+TemplatedService::TemplatedService(QString const &name, QObject *parent) :
+	QObject(parent),
+	mName(name)
+{
+	mSuperviseTimer.setInterval(100);
+	connect(&mSuperviseTimer, SIGNAL(timeout()), SLOT(onSuperviseTimer()));
+}
+
+TemplatedService::TemplatedService(VeQItemSettings *settings, QString const &name, QString const &settingPath, QObject *parent) :
+	TemplatedService(name, parent)
+{
+	VeQItem *item = settings->root()->itemGetOrCreate(settingPath);
+	item->getValueAndChanges(this, SLOT(onSettingChanged(QVariant)));
+}
+
+bool TemplatedService::install()
+{
+	if (QFileInfo(path() + "/supervise/control").exists())
+		return true;
+
+	qDebug() << "[Service] Installing" << mName;
+	if (!ServiceTemplates::instance()->install(mName))
+		return false;
+
+	if (!QStandardPaths::findExecutable("svrescan").isEmpty())
+		ProcessExecutor::instance()->run("svrescan");
+	startWhenSupervised();
+
+	return true;
+}
+
+bool TemplatedService::remove()
+{
+	mSuperviseTimer.stop();
+	if (!QFileInfo(path()).exists())
+		return true;
+
+	qDebug() << "[Service] Removing" << mName;
+	return ServiceTemplates::instance()->remove(mName);
+}
+
+void TemplatedService::installOrRemove(bool install)
+{
+	if (install)
+		this->install();
+	else
+		remove();
+}
+
+void TemplatedService::onSettingChanged(QVariant var)
+{
+	if (!var.isValid())
+		return;
+
+	installOrRemove(var.toInt() == 1);
+}
+
+// svscan picks the service up asynchronously, it can only be controlled once supervised.
+void TemplatedService::startWhenSupervised()
+{
+	mSuperviseRetries = 70;
+	mSuperviseTimer.start();
+}
+
+void TemplatedService::onSuperviseTimer()
+{
+	if (QFileInfo(path() + "/supervise/control").exists()) {
+		mSuperviseTimer.stop();
+		SuperviseControl::send(path(), "u");
+		return;
+	}
+
+	if (--mSuperviseRetries <= 0) {
+		mSuperviseTimer.stop();
+		qWarning() << "[Service]" << mName << "is not supervised";
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QStringList>
+#include <QTimer>
+
+#include <veutil/qt/ve_qitems_dbus.hpp>
+
+// Creates daemontools services from the templates in /opt/victronenergy/service-templates,
+// like svectl used to do with a shell loop and sed. The conf file and the template tree
+// of a service are parsed once and kept in memory. A service dir is written next to its
+// final location and then renamed into place, so svscan never sees a half written one.
+//
+// Parameters, -D in svectl, replace the first occurrence of the name on every line of
+// run and log/run and in the SERVICE_EXT, which is appended to the service name.
+class ServiceTemplates
+{
+public:
+	typedef QList<QPair<QString, QString> > Params;
+
+	static ServiceTemplates *instance();
+	ServiceTemplates(QString const &templateDir = "/opt/victronenergy/service-templates");
+
+	bool install(QString const &service, Params const &params = Params(), bool permanent = false);
+	bool remove(QString const &service, Params const &params = Params());
+	QString serviceDirName(QString const &service, Params const &params = Params());
+	QStringList available() const;
+	QString const &lastError() const { return mLastError; }
+
+	static QString const serviceDir;
+	static QString const permanentServiceDir;
+	static QString const configDir;
+
+	static int cli(int argc, char *argv[]);
+
+private:
+	struct Entry {
+		enum Type {
+			DIR,
+			FILE,
+			LINK
+		};
+
+		QString path;
+		Type type;
+		QByteArray data;
+		QFile::Permissions permissions;
+	};
+
+	struct Template {
+		QStringList params;
+		QStringList paramHelp;
+		QString serviceExt;
+		QList<Entry> entries;
+	};
+
+	Template const *compiled(QString const &service);
+	bool parseConfig(QString const &fileName, Template &tmpl, QStringList &included);
+	bool loadTree(QString const &dir, QString const &prefix, QList<Entry> &entries);
+	bool checkParams(Template const &tmpl, Params const &params);
+	bool createServiceDir(Template const &tmpl, QString const &target, Params const &params);
+	bool link(QString const &target, QString const &linkName);
+	bool error(QString const &message);
+	static QByteArray substitute(QByteArray const &data, Params const &params);
+
+	QString mTemplateDir;
+	QHash<QString, Template> mTemplates;
+	QString mLastError;
+};
+
+// A service created from a template, optionally installed when a setting is enabled.
+// This replaces DaemonToolsService with svectl arguments, without forking svectl.
+class TemplatedService : public QObject
+{
+	Q_OBJECT
+
+public:
+	TemplatedService(QString const &name, QObject *parent = 0);
+	TemplatedService(VeQItemSettings *settings, QString const &name, QString const &settingPath, QObject *parent = 0);
+
+	QString path() const { return "/service/" + mName; }
+	bool install();
+	bool remove();
+	void installOrRemove(bool install);
+
+private slots:
+	void onSettingChanged(QVariant var);
+	void onSuperviseTimer();
+
+private:
+	void startWhenSupervised();
+
+	QString mName;
+	QTimer mSuperviseTimer;
+	int mSuperviseRetries = 0;
+};
@@ -0,0 +1,133 @@
+#include <QDebug>
+#include <QTimer>
+
+#include "startup.hpp"
+#include "startup_timeline.hpp"
+
+StartupStages::StartupStages(VeQItem *parentItem, QObject *parent) :
+	QObject(parent)
+{
+	mItem = parentItem->itemGetOrCreate("Startup");
+	mItem->itemGetOrCreateAndProduce("State", QString());
+	mItem->itemGetOrCreateAndProduce("Finished", 0);
+}
+
+void StartupStages::add(QString const &name, QObject *receiver, const char *member,
+						QStringList const &dependencies, bool async)
+{
+	Stage stage;
+	stage.name = name;
+	stage.receiver = receiver;
+	stage.member = member;
+	stage.dependencies = dependencies;
+	stage.async = async;
+	stage.state = STAGE_PENDING;
+	mStages.append(stage);
+
+	mItem->itemGetOrCreateAndProduce("Stages/" + name, STAGE_PENDING);
+}
+
+void StartupStages::start()
+{
+	scheduleNext();
+}
+
+bool StartupStages::isDone(QString const &name) const
+{
+	return mDone.contains(name);
+}
+
+void StartupStages::done(QString const &name)
+{
+	Stage *stage = findStage(name);
+	if (!stage || stage->state == STAGE_DONE)
+		return;
+
+	stage->state = STAGE_DONE;
+	mDone.append(name);
+	mItem->itemGetOrCreateAndProduce("Stages/" + name, STAGE_DONE);
+	StartupTimeline::instance()->end("Stages/" + name);
+	qDebug() << "[Startup] stage" << name << "done";
+
+	emit stageDone(name);
+	updateState();
+	scheduleNext();
+}
+
+StartupStages::Stage *StartupStages::findStage(QString const &name)
+{
+	for (Stage &stage: mStages) {
+		if (stage.name == name)
+			return &stage;
+	}
+	return nullptr;
+}
+
+bool StartupStages::isReady(Stage const &stage) const
+{
+	if (stage.state != STAGE_PENDING)
+		return false;
+
+	for (QString const &dependency: stage.dependencies) {
+		if (!mDone.contains(dependency))
+			return false;
+	}
+
+	return true;
+}
+
+void StartupStages::scheduleNext()
+{
+	if (mScheduled)
+		return;
+
+	mScheduled = true;
+	QTimer::singleShot(0, this, SLOT(runNext()));
+}
+
+void StartupStages::runNext()
+{
+	mScheduled = false;
+
+	for (Stage &stage: mStages) {
+		if (!isReady(stage))
+			continue;
+
+		QString name = stage.name;
+		bool async = stage.async;
+
+		stage.state = STAGE_RUNNING;
+		mItem->itemGetOrCreateAndProduce("Stages/" + name, STAGE_RUNNING);
+		StartupTimeline::instance()->begin("Stages/" + name);
+		QMetaObject::invokeMethod(stage.receiver, stage.member, Qt::DirectConnection);
+
+		// Note: the stage can have called done() itself, which also schedules the next one.
+		if (!async)
+			done(name);
+		else
+			scheduleNext();
+		return;
+	}
+
+	// Waiting for async stages to complete
+	for (Stage const &stage: mStages) {
+		if (stage.state == STAGE_RUNNING)
+			return;
+	}
+
+	for (Stage const &stage: mStages) {
+		if (stage.state == STAGE_PENDING)
+			qCritical() << "[Startup] stage" << stage.name << "can't be started, check its dependencies";
+	}
+}
+
+void StartupStages::updateState()
+{
+	mItem->itemGetOrCreateAndProduce("State", mDone.join(","));
+
+	if (mDone.count() != mStages.count())
+		return;
+
+	mItem->itemGetOrCreateAndProduce("Finished", 1);
+	emit finished();
+}
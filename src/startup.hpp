@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QList>
+#include <QObject>
+#include <QStringList>
+
+#include <veutil/qt/ve_qitem.hpp>
+
+// Runs the startup in stages. A stage is a slot of the receiver, which is invoked
+// once all stages it depends on are done. Stages are run one at a time from the
+// event loop, so dbus traffic is handled in between. An async stage is only done
+// once done() is called for it, e.g. when a spawned process has finished.
+class StartupStages : public QObject
+{
+	Q_OBJECT
+
+public:
+	enum StageState {
+		STAGE_PENDING,
+		STAGE_RUNNING,
+		STAGE_DONE
+	};
+
+	StartupStages(VeQItem *parentItem, QObject *parent = 0);
+
+	void add(QString const &name, QObject *receiver, const char *member,
+			 QStringList const &dependencies = QStringList(), bool async = false);
+	void start();
+	void done(QString const &name);
+	bool isDone(QString const &name) const;
+
+signals:
+	void stageDone(QString const &name);
+	void finished();
+
+private slots:
+	void runNext();
+
+private:
+	struct Stage {
+		QString name;
+		QObject *receiver;
+		const char *member;
+		QStringList dependencies;
+		bool async;
+		StageState state;
+	};
+
+	Stage *findStage(QString const &name);
+	bool isReady(Stage const &stage) const;
+	void scheduleNext();
+	void updateState();
+
+	QList<Stage> mStages;
+	QStringList mDone;
+	VeQItem *mItem;
+	bool mScheduled = false;
+};
@@ -0,0 +1,118 @@
+#include <time.h>
+#include <unistd.h>
+
+#include <QDebug>
+#include <QFile>
+#include <QVariantList>
+#include <QVariantMap>
+
+#include "json.h"
+#include "startup_timeline.hpp"
+
+StartupTimeline *StartupTimeline::instance()
+{
+	static StartupTimeline timeline;
+	return &timeline;
+}
+
+qint64 StartupTimeline::now()
+{
+	struct timespec tv;
+	if (clock_gettime(CLOCK_MONOTONIC, &tv) != 0)
+		return 0;
+	return static_cast<qint64>(tv.tv_sec) * 1000000 + tv.tv_nsec / 1000;
+}
+
+StartupTimeline::Phase *StartupTimeline::findPhase(QString const &name)
+{
+	for (Phase &phase: mPhases) {
+		if (phase.name == name)
+			return &phase;
+	}
+	return nullptr;
+}
+
+void StartupTimeline::begin(QString const &name)
+{
+	if (findPhase(name))
+		return;
+
+	Phase phase;
+	phase.name = name;
+	phase.start = now();
+	phase.end = -1;
+	mPhases.append(phase);
+}
+
+void StartupTimeline::end(QString const &name)
+{
+	Phase *phase = findPhase(name);
+	if (!phase || phase->end >= 0)
+		return;
+
+	phase->end = now();
+	qDebug() << "[Startup]" << name << "took" << (phase->end - phase->start) / 1000 << "ms";
+	publishPhase(*phase);
+}
+
+void StartupTimeline::publish(VeQItem *parentItem)
+{
+	mItem = parentItem->itemGetOrCreate("Debug/Startup");
+	for (Phase const &phase: mPhases) {
+		if (phase.end >= 0)
+			publishPhase(phase);
+	}
+}
+
+void StartupTimeline::publishPhase(Phase const &phase)
+{
+	if (!mItem)
+		return;
+
+	// in ms, the us are only in the trace file
+	mItem->itemGetOrCreateAndProduce(phase.name + "/Start", phase.start / 1000);
+	mItem->itemGetOrCreateAndProduce(phase.name + "/Duration", (phase.end - phase.start) / 1000);
+}
+
+bool StartupTimeline::writeTrace(QString const &fileName)
+{
+	QVariantList events;
+	qint64 first = -1;
+	qint64 last = -1;
+
+	for (Phase const &phase: mPhases) {
+		if (phase.end < 0)
+			continue;
+
+		QVariantMap event;
+		event.insert("name", phase.name);
+		event.insert("cat", "startup");
+		event.insert("ph", "X");
+		event.insert("ts", phase.start);
+		event.insert("dur", phase.end - phase.start);
+		event.insert("pid", static_cast<qint64>(getpid()));
+		event.insert("tid", 1);
+		events.append(event);
+
+		if (first < 0 || phase.start < first)
+			first = phase.start;
+		if (phase.end > last)
+			last = phase.end;
+	}
+
+	if (mItem && first >= 0)
+		mItem->itemGetOrCreateAndProduce("Total", (last - first) / 1000);
+
+	QVariantMap trace;
+	trace.insert("traceEvents", events);
+	trace.insert("displayTimeUnit", "ms");
+
+	QFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		qWarning() << "[Startup] unable to write" << fileName;
+		return false;
+	}
+	file.write(QtJson::serialize(trace));
+
+	return true;
+}
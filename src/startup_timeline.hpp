@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QList>
+#include <QString>
+
+#include <veutil/qt/ve_qitem.hpp>
+
+// Records the phases of the boot path with monotonic timestamps, so boot times can
+// be compared between firmware versions and GX models. The phases are exported in
+// Debug/Startup once the service item exists and written as a chrome trace file
+// (chrome://tracing, perfetto) when the startup is finished.
+//
+// Timestamps are in us since boot (CLOCK_MONOTONIC), phases are only recorded once,
+// e.g. a later language change doesn't overwrite the startup translation load.
+class StartupTimeline
+{
+public:
+	static StartupTimeline *instance();
+	static qint64 now();
+
+	void begin(QString const &name);
+	void end(QString const &name);
+	void publish(VeQItem *parentItem);
+	bool writeTrace(QString const &fileName = "/run/venus-platform-startup.json");
+
+private:
+	struct Phase {
+		QString name;
+		qint64 start;
+		qint64 end;
+	};
+
+	StartupTimeline() {}
+	Phase *findPhase(QString const &name);
+	void publishPhase(Phase const &phase);
+
+	QList<Phase> mPhases;
+	VeQItem *mItem = nullptr;
+};
+
+// Records a phase for the lifetime of this object.
+class StartupPhase
+{
+public:
+	StartupPhase(QString const &name) : mName(name) { StartupTimeline::instance()->begin(mName); }
+	~StartupPhase() { StartupTimeline::instance()->end(mName); }
+
+private:
+	QString mName;
+};
@@ -0,0 +1,78 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+
+#include "supervise_control.hpp"
+
+// TAI64 label of the unix epoch, including the 10 leap seconds daemontools assumes
+static const quint64 tai64UnixEpoch = 4611686018427387914ULL;
+
+bool SuperviseControl::send(QString const &serviceDir, QByteArray const &commands)
+{
+	QString control = serviceDir + "/supervise/control";
+
+	// Opening the fifo fails with ENXIO when supervise is not running.
+	int fd = open(QFile::encodeName(control).constData(), O_WRONLY | O_NDELAY | O_CLOEXEC);
+	if (fd < 0) {
+		qWarning() << "[Supervise] unable to control" << serviceDir << strerror(errno);
+		return false;
+	}
+
+	ssize_t written = write(fd, commands.constData(), commands.size());
+	close(fd);
+
+	if (written != commands.size()) {
+		qWarning() << "[Supervise] unable to send" << commands << "to" << serviceDir;
+		return false;
+	}
+
+	return true;
+}
+
+// Like svc -t /service/mk2-dbus.*, the pattern is a wildcard on the entries in dir.
+int SuperviseControl::sendAll(QString const &dir, QString const &pattern, QByteArray const &commands)
+{
+	QDir services(dir);
+	int n = 0;
+
+	for (QString const &service: services.entryList(QStringList() << pattern, QDir::Dirs | QDir::NoDotAndDotDot)) {
+		if (send(services.filePath(service), commands))
+			n++;
+	}
+
+	return n;
+}
+
+// supervise/status is 18 bytes: a TAI64N timestamp (12), the pid as a little endian
+// 32 bit value (4), paused (1) and the wanted state, 'u' or 'd' (1).
+SuperviseControl::Status SuperviseControl::status(QString const &serviceDir)
+{
+	Status ret;
+	QFile file(serviceDir + "/supervise/status");
+
+	if (!file.open(QIODevice::ReadOnly))
+		return ret;
+
+	QByteArray data = file.read(18);
+	if (data.size() < 18)
+		return ret;
+
+	unsigned char const *s = reinterpret_cast<unsigned char const *>(data.constData());
+
+	quint64 tai = 0;
+	for (int i = 0; i < 8; i++)
+		tai = (tai << 8) | s[i];
+
+	ret.valid = true;
+	ret.since = tai >= tai64UnixEpoch ? static_cast<qint64>(tai - tai64UnixEpoch) : 0;
+	ret.pid = s[12] | (s[13] << 8) | (s[14] << 16) | (s[15] << 24);
+	ret.paused = s[16] != 0;
+	ret.want = static_cast<char>(s[17]);
+
+	return ret;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+// Controls daemontools services directly instead of spawning svc. The commands are
+// the ones of svc, e.g. "u" (up), "d" (down), "t" (SIGTERM) or "h" (SIGHUP), and are
+// written to the supervise/control fifo. Since svc does just that as well, the
+// service is not yet up or down when this returns.
+class SuperviseControl
+{
+public:
+	struct Status {
+		bool valid = false;
+		int pid = 0;
+		bool paused = false;
+		char want = 0;
+		qint64 since = 0; // unix time of the last change
+
+		bool isUp() const { return valid && pid != 0; }
+	};
+
+	static bool send(QString const &serviceDir, QByteArray const &commands);
+	static int sendAll(QString const &dir, QString const &pattern, QByteArray const &commands);
+	static Status status(QString const &serviceDir);
+};
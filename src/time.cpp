@@ -1,12 +1,136 @@
 #include "time.hpp"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/rtc.h>
+#include <string.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
 #include <time.h>
 
 #include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
 #include <QObject>
 #include <QtGlobal>
 
+static QString timestampFile()
+{
+	QString ret = "/etc/timestamp";
+
+	// Like save-rtc.sh, the location can be changed in /etc/default/timestamp.
+	QFile file("/etc/default/timestamp");
+	if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+		while (!file.atEnd()) {
+			QString line = QString::fromUtf8(file.readLine()).trimmed();
+			if (line.startsWith("TIMESTAMP_FILE="))
+				ret = line.mid(15).remove('"').remove('\'');
+		}
+	}
+
+	return ret;
+}
+
+void RtcWriter::store()
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	int rtcError = writeRtc();
+	int error = writeTimestamp();
+
+	emit stored(rtcError ? rtcError : error, timer.elapsed());
+}
+
+// Like hwclock --utc --systohc
+int RtcWriter::writeRtc()
+{
+	int fd = open("/dev/rtc0", O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		fd = open("/dev/rtc", O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return errno;
+
+	time_t now = time(NULL);
+	struct tm tm;
+	gmtime_r(&now, &tm);
+
+	struct rtc_time rtc;
+	rtc.tm_sec = tm.tm_sec;
+	rtc.tm_min = tm.tm_min;
+	rtc.tm_hour = tm.tm_hour;
+	rtc.tm_mday = tm.tm_mday;
+	rtc.tm_mon = tm.tm_mon;
+	rtc.tm_year = tm.tm_year;
+	rtc.tm_wday = tm.tm_wday;
+	rtc.tm_yday = tm.tm_yday;
+	rtc.tm_isdst = 0;
+
+	int ret = ioctl(fd, RTC_SET_TIME, &rtc) < 0 ? errno : 0;
+	close(fd);
+
+	return ret;
+}
+
+// Like save-rtc.sh, so time can be set backwards with a power cycle. Only this file
+// is flushed, not every dirty page in the system. The file can be a symlink, e.g. to
+// the data partition, the file it points to is replaced then, not the link itself.
+int RtcWriter::writeTimestamp()
+{
+	QString fileName = timestampFile();
+	QString target = QFileInfo(fileName).canonicalFilePath();
+	if (!target.isEmpty())
+		fileName = target;
+
+	QByteArray tmp = QFile::encodeName(fileName + ".tmp");
+	QByteArray stamp = QDateTime::currentDateTimeUtc().toString("yyyyMMddhhmmss").toLatin1() + "\n";
+
+	int fd = open(tmp.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return errno;
+
+	int ret = 0;
+	errno = 0;
+	if (write(fd, stamp.constData(), stamp.size()) != stamp.size() || fdatasync(fd) < 0)
+		ret = errno ? errno : EIO;
+	close(fd);
+
+	if (ret == 0 && rename(tmp.constData(), QFile::encodeName(fileName).constData()) < 0)
+		ret = errno;
+
+	if (ret) {
+		unlink(tmp.constData());
+		return ret;
+	}
+
+	// and the rename itself
+	int dirFd = open(QFile::encodeName(QFileInfo(fileName).absolutePath()).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirFd >= 0) {
+		fsync(dirFd);
+		close(dirFd);
+	}
+
+	return 0;
+}
+
+VeQItemTime::VeQItemTime() :
+	VeQItemExportedLeaf()
+{
+	mWriter = new RtcWriter();
+	mWriter->moveToThread(&mThread);
+	connect(&mThread, SIGNAL(finished()), mWriter, SLOT(deleteLater()));
+	connect(mWriter, SIGNAL(stored(int,qint64)), this, SLOT(onStored(int,qint64)));
+	mThread.start();
+}
+
+VeQItemTime::~VeQItemTime()
+{
+	mThread.quit();
+	mThread.wait();
+}
+
 int VeQItemTime::setValue(const QVariant &value)
 {
 	bool ok;
@@ -18,18 +142,31 @@ int VeQItemTime::setValue(const QVariant &value)
 	tv.tv_sec = secSinceEpoch;
 	tv.tv_nsec = 0;
 
-	clock_settime(CLOCK_REALTIME, &tv);
+	if (clock_settime(CLOCK_REALTIME, &tv) != 0)
+		return -1;
 
-	system("hwclock --utc --systohc");
+	// Storing the time in the RTC and the timestamp file is done by the writer thread,
+	// the item is Storing until that is done.
+	mPending++;
+	setState(VeQItem::Storing);
+	QMetaObject::invokeMethod(mWriter, "store", Qt::QueuedConnection);
 
-	// update the timestamp file as well, so time can be set backwards with a power cycle
-	system("/etc/init.d/save-rtc.sh");
+	return 0;
+}
 
-	sync();
+void VeQItemTime::onStored(int error, qint64 elapsedMs)
+{
+	if (error)
+		qWarning() << "[Time] storing the time failed:" << strerror(error);
 
-	produceValue(getValue());
+	VeQItem *parent = itemParent();
+	if (parent) {
+		parent->itemGetOrCreateAndProduce("Rtc/Error", error);
+		parent->itemGetOrCreateAndProduce("Rtc/Duration", elapsedMs);
+	}
 
-	return 0;
+	if (--mPending == 0)
+		produceValue(getValue());
 }
 
 QVariant VeQItemTime::getValue()
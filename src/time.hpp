@@ -1,17 +1,43 @@
 #pragma once
 
 #include <QObject>
+#include <QThread>
 
 #include <veutil/qt/ve_qitem_utils.hpp>
 
+// Writes the system time to the RTC and the timestamp file, like hwclock --systohc and
+// save-rtc.sh did, but without the global sync. Runs in its own thread, since flushing
+// to a slow SD card or eMMC can still take a while.
+class RtcWriter : public QObject {
+	Q_OBJECT
+
+public slots:
+	void store();
+
+signals:
+	void stored(int error, qint64 elapsedMs);
+
+private:
+	int writeRtc();
+	int writeTimestamp();
+};
+
 class VeQItemTime : public VeQItemExportedLeaf {
 	Q_OBJECT
 
 public:
-	VeQItemTime() : VeQItemExportedLeaf() {}
-	virtual ~VeQItemTime() {}
+	VeQItemTime();
+	virtual ~VeQItemTime();
 
 	int setValue(const QVariant &value) override;
 	QVariant getValue() override;
 	QString getText() override;
+
+private slots:
+	void onStored(int error, qint64 elapsedMs);
+
+private:
+	QThread mThread;
+	RtcWriter *mWriter;
+	int mPending = 0;
 };
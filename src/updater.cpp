@@ -4,6 +4,7 @@
 #include <QLocalSocket>
 
 #include "application.hpp"
+#include "publish_batch.hpp"
 #include "updater.hpp"
 #include <veutil/qt/ve_qitem_utils.hpp>
 #include <veutil/qt/firmware_updater_data.hpp>
@@ -171,20 +172,21 @@ void Updater::getUpdateInfoFromFile(QString const &fileName)
 	// Line 0 = status, line 1 = "timestamp<space>version"
 	int status = lines[0].trimmed().toInt() + FirmwareUpdaterData::Idle;
 
+	PublishBatch batch(mItem);
 	QVariant build, version;
 	getVersionInfoFromLine(lines[1], build, version);
-	mItem->itemGetOrCreateAndProduce("Online/AvailableVersion", version);
-	mItem->itemGetOrCreateAndProduce("Online/AvailableBuild", build);
+	batch.produce(mItem, "Online/AvailableVersion", version);
+	batch.produce(mItem, "Online/AvailableBuild", build);
 
 	getVersionInfoFromLine(lines[2], build, version);
-	mItem->itemGetOrCreateAndProduce("Offline/AvailableVersion", version);
-	mItem->itemGetOrCreateAndProduce("Offline/AvailableBuild", build);
+	batch.produce(mItem, "Offline/AvailableVersion", version);
+	batch.produce(mItem, "Offline/AvailableBuild", build);
 
 	// Installing starts with checking for an update first, ignore that state.
 	VeQItem *state = mItem->itemGet("State");
-	if (!(state->getLocalValue().toInt() == FirmwareUpdaterData::DownloadingAndInstalling &&
+	if (!(batch.value(state).toInt() == FirmwareUpdaterData::DownloadingAndInstalling &&
 			status == FirmwareUpdaterData::Checking))
-		state->produceValue(status);
+		batch.produce(state, status);
 }
 
 void Updater::getRootfsInfoFromFile(const QString &fileName)
@@ -4,12 +4,16 @@
 #include "venus_service.hpp"
 #include "venus_services.hpp"
 
+int VenusService::sInstances = 0;
+
 VenusService::VenusService(VeQItem *serviceItem, VenusServiceType serviceType, QObject *parent) :
 	QObject(parent),
 	mServiceType(serviceType),
 	mServiceItem(serviceItem),
 	mInitDone(false)
 {
+	sInstances++;
+
 	// Note: to support service without a CustomName item at all, also the state changes need
 	// to be connected to, since there won't be any valueChange if the CustomName is not supported
 	// at all!
@@ -23,6 +27,7 @@ VenusService::VenusService(VeQItem *serviceItem, VenusServiceType serviceType, Q
 
 VenusService::~VenusService()
 {
+	sInstances--;
 	emit serviceDestroyed();
 	mServiceItem->itemDelete();
 }
@@ -71,11 +76,9 @@ void VenusService::checkInitDone()
 	emit initialized();
 }
 
-VenusService *VenusService::createInstance(VeQItem *serviceItem)
+// The type is determined by VenusServices, when the service appears.
+VenusService *VenusService::createInstance(VeQItem *serviceItem, VenusServiceType type)
 {
-	QString name = serviceItem->id();
-	VenusServiceType type = venusServiceType(name);
-
 	switch (type) {
 	case VenusServiceType::UNKNOWN:
 		return nullptr;
@@ -14,12 +14,17 @@ class VenusService : public QObject
 public:
 	VenusService(VeQItem *serviceItem, VenusServiceType serviceType, QObject *parent = 0);
 	~VenusService();
-	static VenusService *createInstance(VeQItem *serviceItem);
+	static VenusService *createInstance(VeQItem *serviceItem, VenusServiceType type);
+	// The number of instances alive, to check services which come and go don't leak.
+	static int instances() { return sInstances; }
 
 	QString getName() const { return mServiceItem->id(); }
 	QString getDescription() const { return mDescription; }
 	VenusServiceType getType() const { return mServiceType; }
 	bool getConnected() { return mServiceItem->getState() != VeQItem::Offline; }
+	// When the service appeared on the bus, StartupTimeline::now()
+	qint64 discoveredAt() const { return mDiscoveredAt; }
+	void setDiscoveredAt(qint64 us) { mDiscoveredAt = us; }
 
 	inline VeQItem *item(QString const &id = QString()) {
 		if (id.isEmpty())
@@ -41,10 +46,13 @@ protected:
 	virtual void checkInitDone();
 
 private:
+	static int sInstances;
+
 	VenusServiceType mServiceType;
 	QString mDescription;
 	VeQItem *mServiceItem;
 	bool mInitDone;
+	qint64 mDiscoveredAt = 0;
 };
 
 class VenusTankService : public VenusService
@@ -1,5 +1,9 @@
+#include <QDebug>
+
 #include <veutil/qt/ve_qitem.hpp>
 
+#include "alarm_stats.hpp"
+#include "startup_timeline.hpp"
 #include "venus_service.hpp"
 #include "venus_services.hpp"
 
@@ -11,30 +15,201 @@ void VenusServices::initialScan()
 		onServiceAdded(service);
 }
 
+void VenusServices::subscribe(VenusServiceType type, QObject *receiver, char const *onFound, char const *onLost)
+{
+	Subscription subscription;
+	subscription.receiver = receiver;
+	subscription.onFound = onFound;
+	subscription.onLost = onLost;
+	mSubscriptions[static_cast<int>(type)].append(subscription);
+
+	for (VenusService *service: services(type)) {
+		if (service->getConnected())
+			QMetaObject::invokeMethod(receiver, onFound, Q_ARG(VenusService *, service));
+	}
+}
+
+// Informs the subscribers of the type of the service.
+void VenusServices::notify(VenusService *service, bool found)
+{
+	QList<Subscription> &subscriptions = mSubscriptions[static_cast<int>(service->getType())];
+
+	for (int n = 0; n < subscriptions.size();) {
+		Subscription const &subscription = subscriptions[n];
+		if (!subscription.receiver) {
+			subscriptions.removeAt(n);
+			continue;
+		}
+
+		QByteArray const &method = found ? subscription.onFound : subscription.onLost;
+		if (!method.isEmpty())
+			QMetaObject::invokeMethod(subscription.receiver, method.constData(), Q_ARG(VenusService *, service));
+		n++;
+	}
+}
+
+/*
+ * When a service appears, its whole tree is obtained with a single GetItems call, after
+ * which the service item is Synchronized. The VenusService and the alarms are only created
+ * after that, so they find their items seeded from that snapshot, instead of requesting
+ * ProductName, CustomName and every alarm trigger one by one while it is pending. Services
+ * which never get there, e.g. not responding, are created anyway after a while.
+ */
 void VenusServices::onServiceAdded(VeQItem *serviceItem)
+{
+	VenusServiceType type = venusServiceType(serviceItem->id());
+	if (type == VenusServiceType::UNKNOWN)
+		return;
+
+	if (serviceItem->getState() == VeQItem::Synchronized) {
+		createService(serviceItem, type, StartupTimeline::now());
+		return;
+	}
+
+	mPending.insert(serviceItem, {type, StartupTimeline::now()});
+	connect(serviceItem, SIGNAL(stateChanged(VeQItem::State)), SLOT(onServiceStateChanged(VeQItem::State)));
+	connect(serviceItem, SIGNAL(destroyed(QObject*)), SLOT(onPendingDestroyed(QObject*)));
+	if (!mSnapshotTimer.isActive())
+		mSnapshotTimer.start();
+}
+
+void VenusServices::onServiceStateChanged(VeQItem::State state)
+{
+	VeQItem *serviceItem = static_cast<VeQItem *>(sender());
+
+	if (state != VeQItem::Synchronized || !mPending.contains(serviceItem))
+		return;
+
+	serviceItem->disconnect(this);
+	Pending pending = mPending.take(serviceItem);
+	createService(serviceItem, pending.type, pending.since);
+}
+
+void VenusServices::onPendingDestroyed(QObject *object)
+{
+	mPending.remove(static_cast<VeQItem *>(object));
+}
+
+void VenusServices::onSnapshotTimeout()
+{
+	qint64 now = StartupTimeline::now();
+
+	for (auto it = mPending.begin(); it != mPending.end();) {
+		if (now - it.value().since < snapshotTimeout * 1000000LL) {
+			++it;
+			continue;
+		}
+
+		VeQItem *serviceItem = it.key();
+		Pending pending = it.value();
+		it = mPending.erase(it);
+		qWarning() << "[Services] no snapshot of" << serviceItem->id() << "creating it anyway";
+		serviceItem->disconnect(this);
+		createService(serviceItem, pending.type, pending.since);
+	}
+
+	if (mPending.isEmpty())
+		mSnapshotTimer.stop();
+}
+
+void VenusServices::createService(VeQItem *serviceItem, VenusServiceType type, qint64 discoveredAt)
 {
 	VenusService *service;
 
-	service = VenusService::createInstance(serviceItem);
+	service = VenusService::createInstance(serviceItem, type);
 	if (service == nullptr)
 		return;
 	service->setParent(this);
+	service->setDiscoveredAt(discoveredAt);
 	connect(service, SIGNAL(serviceDestroyed()), SLOT(onServiceDestoyed()));
 	connect(service, SIGNAL(initialized()), SLOT(onServiceInitialized()));
 }
 
+// The service knows its name, so it is found directly instead of searching its value.
 void VenusServices::onServiceDestoyed()
 {
-	VenusService *service = qobject_cast<VenusService *>(sender());
-	mServices.remove(mServices.key(service));
+	VenusService *service = static_cast<VenusService *>(sender());
+
+	auto it = mServices.find(service->getName());
+	if (it == mServices.end() || it.value() != service)
+		return;
+
+	mServices.erase(it);
+	mBuckets[static_cast<int>(service->getType())].remove(service);
+	mOffline.remove(service);
+	if (mConnected.remove(service))
+		notify(service, false);
 }
 
 void VenusServices::onConnectedChanged(VenusService *service)
 {
-	if (service->getConnected())
+	if (service->getConnected()) {
+		mConnected.insert(service);
+		mOffline.remove(service);
 		emit connected(service);
-	else
+		notify(service, true);
+	} else {
+		bool wasConnected = mConnected.remove(service);
+		if (!mKept.contains(service->getName())) {
+			mOffline.insert(service, StartupTimeline::now());
+			if (mGracePeriod > 0 && !mReclaimTimer.isActive())
+				mReclaimTimer.start();
+		}
 		emit disconnected(service);
+		if (wasConnected)
+			notify(service, false);
+	}
+}
+
+void VenusServices::setGracePeriod(QVariant var)
+{
+	if (!var.isValid())
+		return;
+
+	mGracePeriod = var.toInt();
+	if (mGracePeriod <= 0)
+		mReclaimTimer.stop();
+	else if (!mOffline.isEmpty())
+		mReclaimTimer.start();
+}
+
+/*
+ * Devices like BLE sensors and tank senders come and go, a service which has been offline
+ * for longer than the grace period is deleted, together with its alarms and its item tree.
+ * If it returns, the producer creates its item again and it is added like any new service,
+ * from the snapshot of its items.
+ */
+void VenusServices::onReclaimTimeout()
+{
+	qint64 now = StartupTimeline::now();
+	QList<VenusService *> expired;
+
+	for (auto it = mOffline.constBegin(); it != mOffline.constEnd(); ++it) {
+		if (now - it.value() >= mGracePeriod * 1000000LL)
+			expired.append(it.key());
+	}
+
+	for (VenusService *service: expired) {
+		QString name = service->getName();
+		qDebug() << "[Services] reclaiming" << name << "offline for more than" << mGracePeriod << "s";
+		delete service;
+		if (AlarmStats::instance())
+			AlarmStats::instance()->serviceReclaimed(name);
+	}
+
+	if (mOffline.isEmpty())
+		mReclaimTimer.stop();
+}
+
+void VenusServices::onServiceConnectedChanged()
+{
+	VenusService *service = static_cast<VenusService *>(sender());
+
+	// Only state changes between connected and disconnected are of interest.
+	if (mConnected.contains(service) == service->getConnected())
+		return;
+
+	onConnectedChanged(service);
 }
 
 void VenusServices::onServiceInitialized()
@@ -43,6 +218,9 @@ void VenusServices::onServiceInitialized()
 
 	QString name = service->getName();
 	mServices.insert(name, service);
+	mBuckets[static_cast<int>(service->getType())].insert(service);
 	emit found(service);
+
+	connect(service, SIGNAL(connectedChanged()), SLOT(onServiceConnectedChanged()));
 	onConnectedChanged(service);
 }
@@ -1,10 +1,20 @@
 #pragma once
 
+#include <QHash>
 #include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QTimer>
+#include <QVariant>
 
 #include <veutil/qt/ve_qitem.hpp>
 #include "venus_service.hpp"
 
+/*
+ * The registry of the venus services on the bus. A service is classified once, when its
+ * bus name appears, and kept in a bucket of its type, so users can subscribe to the types
+ * they need instead of testing all bus names themselves.
+ */
 class VenusServices : public QObject
 {
 	Q_OBJECT
@@ -14,9 +24,30 @@ public:
 		QObject(parent),
 		mQItemServices(services)
 	{
+		mSnapshotTimer.setInterval(1000);
+		connect(&mSnapshotTimer, SIGNAL(timeout()), SLOT(onSnapshotTimeout()));
+		mReclaimTimer.setInterval(10000);
+		connect(&mReclaimTimer, SIGNAL(timeout()), SLOT(onReclaimTimeout()));
 	}
 
 	void initialScan();
+	QList<VenusService *> services() const { return mServices.values(); }
+	QList<VenusService *> services(VenusServiceType type) const { return mBuckets.value(static_cast<int>(type)).values(); }
+	VenusService *service(QString const &name) const { return mServices.value(name); }
+
+	/*
+	 * Invokes the method onFound of receiver with the VenusService * when a service of the
+	 * type is found or connected again, including the ones which are already there, and
+	 * onLost, if set, when it is disconnected or removed.
+	 */
+	void subscribe(VenusServiceType type, QObject *receiver, char const *onFound, char const *onLost = nullptr);
+
+	// Services whose items are used elsewhere, they are never reclaimed.
+	void keep(QString const &name) { mKept.insert(name); }
+
+public slots:
+	// Seconds a service can be offline before it is reclaimed, 0 to keep them.
+	void setGracePeriod(QVariant var);
 
 signals:
 	void connected(VenusService *service);
@@ -30,10 +61,40 @@ signals:
 private slots:
 	void onConnectedChanged(VenusService *service);
 	void onServiceAdded(VeQItem *serviceItem);
+	void onServiceStateChanged(VeQItem::State state);
+	void onServiceConnectedChanged();
 	void onServiceDestoyed();
 	void onServiceInitialized();
+	void onSnapshotTimeout();
+	void onPendingDestroyed(QObject *object);
+	void onReclaimTimeout();
 
 private:
+	static int const snapshotTimeout = 10; // s
+
+	struct Pending {
+		VenusServiceType type;
+		qint64 since;
+	};
+
+	struct Subscription {
+		QPointer<QObject> receiver;
+		QByteArray onFound;
+		QByteArray onLost;
+	};
+
+	void createService(VeQItem *serviceItem, VenusServiceType type, qint64 discoveredAt);
+	void notify(VenusService *service, bool found);
+
 	QHash<QString, VenusService *> mServices;
+	QHash<int, QSet<VenusService *>> mBuckets; // by VenusServiceType
+	QSet<VenusService *> mConnected;
+	QHash<int, QList<Subscription>> mSubscriptions; // by VenusServiceType
+	QHash<VeQItem *, Pending> mPending; // waiting for their snapshot
+	QHash<VenusService *, qint64> mOffline; // since, StartupTimeline::now()
+	QSet<QString> mKept;
+	QTimer mSnapshotTimer;
+	QTimer mReclaimTimer;
+	int mGracePeriod = 600; // s
 	VeQItem *mQItemServices;
 };
@@ -0,0 +1,26 @@
+# Alarm load test, see load_test.hpp. Runs against a venus-platform binary:
+#   alarm_load [--services 5] [--samples 200] [--rate 100] path/to/venus-platform
+# or as a churn soak test, failing if the services, alarms or memory don't stay flat:
+#   alarm_load --churn 10000 [--tolerance 1024] path/to/venus-platform
+
+TEMPLATE = app
+TARGET = alarm_load
+QT = core dbus
+CONFIG += console
+CONFIG -= app_bundle
+
+equals(QT_MAJOR_VERSION, 6): QMAKE_CXXFLAGS += -std=c++17
+
+INCLUDEPATH += ../..
+
+HEADERS = \
+	bus_service.hpp \
+	load_test.hpp
+
+SOURCES = \
+	../../src/alarm_tables.cpp \
+	bus_service.cpp \
+	load_test.cpp \
+	main.cpp
+
+include(../../ext/veutil/veutil.pri)
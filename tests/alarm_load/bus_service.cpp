@@ -0,0 +1,249 @@
+#include <QDBusArgument>
+#include <QDBusMetaType>
+#include <QSet>
+
+#include "bus_service.hpp"
+
+static char const busItemInterface[] = "com.victronenergy.BusItem";
+
+static char const busItemIntrospection[] =
+	"<interface name=\"com.victronenergy.BusItem\">"
+	"<method name=\"GetValue\"><arg direction=\"out\" type=\"v\"/></method>"
+	"<method name=\"GetText\"><arg direction=\"out\" type=\"v\"/></method>"
+	"<method name=\"SetValue\"><arg direction=\"in\" type=\"v\"/><arg direction=\"out\" type=\"i\"/></method>"
+	"<signal name=\"PropertiesChanged\"><arg type=\"a{sv}\"/></signal>"
+	"</interface>";
+
+// An invalid value is an empty array on the bus.
+static QVariant busValue(QVariant const &value)
+{
+	return value.isValid() ? value : QVariant(QVariantList());
+}
+
+static QVariant plainValue(QVariant const &arg)
+{
+	if (arg.userType() == qMetaTypeId<QDBusVariant>())
+		return arg.value<QDBusVariant>().variant();
+	return arg;
+}
+
+static QVariantMap itemProperties(QVariant const &value)
+{
+	QVariantMap properties;
+	properties.insert("Value", busValue(value));
+	properties.insert("Text", value.toString());
+	return properties;
+}
+
+BusService::BusService(QString const &address, QString const &name, QObject *parent) :
+	QDBusVirtualObject(parent),
+	mConnection(QDBusConnection::connectToBus(address, name + QString::number(quintptr(this)))),
+	mName(name)
+{
+	mConnection.registerVirtualObject("/", this, QDBusConnection::SubPath);
+}
+
+BusService::~BusService()
+{
+	unregisterService();
+	mConnection.unregisterObject("/");
+	QDBusConnection::disconnectFromBus(mConnection.name());
+}
+
+void BusService::registerTypes()
+{
+	qDBusRegisterMetaType<BusItemMap>();
+	qDBusRegisterMetaType<QList<QVariantMap>>();
+}
+
+bool BusService::registerService()
+{
+	if (!mRegistered)
+		mRegistered = mConnection.registerService(mName);
+	return mRegistered;
+}
+
+void BusService::unregisterService()
+{
+	if (!mRegistered)
+		return;
+
+	mConnection.unregisterService(mName);
+	mRegistered = false;
+}
+
+void BusService::set(QString const &path, QVariant const &value)
+{
+	auto it = mValues.find(path);
+	if (it != mValues.end() && it.value() == value && it.value().isValid() == value.isValid())
+		return;
+
+	mValues.insert(path, value);
+	changed(path);
+}
+
+void BusService::changed(QString const &path)
+{
+	if (!mRegistered)
+		return;
+
+	QVariantMap properties = itemProperties(mValues.value(path));
+
+	QDBusMessage signal = QDBusMessage::createSignal(path, busItemInterface, "PropertiesChanged");
+	signal << properties;
+	mConnection.send(signal);
+
+	BusItemMap items;
+	items.insert(path, properties);
+	signal = QDBusMessage::createSignal("/", busItemInterface, "ItemsChanged");
+	signal << QVariant::fromValue(items);
+	mConnection.send(signal);
+}
+
+// The values below path by their relative path, like GetValue on a parent node.
+QVariantMap BusService::subtree(QString const &path, bool text) const
+{
+	QString prefix = path == "/" ? path : path + "/";
+	QVariantMap ret;
+
+	for (auto it = mValues.constBegin(); it != mValues.constEnd(); ++it) {
+		if (it.key().startsWith(prefix))
+			ret.insert(it.key().mid(prefix.size()), text ? QVariant(it.value().toString()) : busValue(it.value()));
+	}
+	return ret;
+}
+
+QString BusService::introspect(QString const &path) const
+{
+	QString prefix = path == "/" ? path : path + "/";
+	QSet<QString> children;
+	QString xml = busItemIntrospection;
+
+	for (auto it = mValues.constBegin(); it != mValues.constEnd(); ++it) {
+		if (it.key().startsWith(prefix))
+			children.insert(it.key().mid(prefix.size()).section('/', 0, 0));
+	}
+	for (QString const &child: children)
+		xml += "<node name=\"" + child + "\"/>";
+
+	return xml;
+}
+
+bool BusService::handleMessage(QDBusMessage const &message, QDBusConnection const &connection)
+{
+	QString const path = message.path();
+	QString const member = message.member();
+
+	if (!message.interface().isEmpty() && message.interface() != busItemInterface)
+		return handleOther(message, connection);
+
+	if (member == "GetItems" && path == "/") {
+		BusItemMap items;
+		for (auto it = mValues.constBegin(); it != mValues.constEnd(); ++it)
+			items.insert(it.key(), itemProperties(it.value()));
+		connection.send(message.createReply(QVariant::fromValue(items)));
+		return true;
+	}
+
+	if (member == "GetValue" || member == "GetText") {
+		bool text = member == "GetText";
+		QVariant reply;
+
+		if (mValues.contains(path)) {
+			QVariant value = mValues.value(path);
+			reply = text ? QVariant(value.toString()) : busValue(value);
+		} else {
+			QVariantMap values = subtree(path, text);
+			if (values.isEmpty()) {
+				connection.send(message.createErrorReply(QDBusError::UnknownObject, path));
+				return true;
+			}
+			reply = values;
+		}
+
+		connection.send(message.createReply(QVariant::fromValue(QDBusVariant(reply))));
+		return true;
+	}
+
+	if (member == "SetValue" && !message.arguments().isEmpty()) {
+		if (!mValues.contains(path)) {
+			connection.send(message.createErrorReply(QDBusError::UnknownObject, path));
+			return true;
+		}
+
+		QVariant value = plainValue(message.arguments().first());
+		set(path, value);
+		connection.send(message.createReply(0));
+		emit valueWritten(path, value);
+		return true;
+	}
+
+	return handleOther(message, connection);
+}
+
+bool BusService::handleOther(QDBusMessage const &message, QDBusConnection const &connection)
+{
+	Q_UNUSED(message);
+	Q_UNUSED(connection);
+	return false;
+}
+
+FakeSettings::FakeSettings(QString const &address, QObject *parent) :
+	BusService(address, "com.victronenergy.settings", parent)
+{
+}
+
+// Settings are stored below /Settings, the platform passes them relative to it or not.
+static QString settingPath(QString path)
+{
+	if (!path.startsWith('/'))
+		path.prepend('/');
+	if (!path.startsWith("/Settings/"))
+		path.prepend("/Settings");
+	return path;
+}
+
+bool FakeSettings::handleOther(QDBusMessage const &message, QDBusConnection const &connection)
+{
+	if (message.interface() != "com.victronenergy.Settings")
+		return false;
+
+	QString const member = message.member();
+	QVariantList args = message.arguments();
+
+	// AddSettings(aa{sv}), with path and default per setting, returns the error per setting.
+	if (member == "AddSettings" && args.size() == 1) {
+		QList<QVariantMap> result;
+		QDBusArgument arg = args.first().value<QDBusArgument>();
+
+		arg.beginArray();
+		while (!arg.atEnd()) {
+			QVariantMap setting;
+			arg >> setting;
+
+			QString path = settingPath(setting.value("path").toString());
+			if (!mValues.contains(path))
+				set(path, plainValue(setting.value("default")));
+
+			QVariantMap ret;
+			ret.insert("path", setting.value("path"));
+			ret.insert("error", 0);
+			result.append(ret);
+		}
+		arg.endArray();
+
+		connection.send(message.createReply(QVariant::fromValue(result)));
+		return true;
+	}
+
+	// AddSetting(group, name, default, type, min, max) and the silent variant.
+	if ((member == "AddSetting" || member == "AddSilentSetting") && args.size() >= 3) {
+		QString path = settingPath(args[0].toString() + "/" + args[1].toString());
+		if (!mValues.contains(path))
+			set(path, plainValue(args[2]));
+		connection.send(message.createReply(0));
+		return true;
+	}
+
+	return false;
+}
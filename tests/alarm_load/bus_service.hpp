@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QDBusConnection>
+#include <QDBusVirtualObject>
+#include <QMap>
+#include <QVariant>
+
+typedef QMap<QString, QVariantMap> BusItemMap;
+Q_DECLARE_METATYPE(BusItemMap)
+
+// A minimal venus service on the bus: the com.victronenergy.BusItem interface for a flat
+// set of paths, GetItems on / and the ItemsChanged / PropertiesChanged signals. Every
+// service has a connection of its own, since the object paths are per connection.
+// Paths which are not set don't exist, so the platform sees those items as Offline.
+class BusService : public QDBusVirtualObject
+{
+	Q_OBJECT
+
+public:
+	BusService(QString const &address, QString const &name, QObject *parent = nullptr);
+	~BusService();
+
+	static void registerTypes();
+
+	QString name() const { return mName; }
+	bool isRegistered() const { return mRegistered; }
+
+	// Registers / releases the bus name, the paths and values are kept.
+	bool registerService();
+	void unregisterService();
+
+	void set(QString const &path, QVariant const &value);
+	QVariant value(QString const &path) const { return mValues.value(path); }
+
+	QString introspect(QString const &path) const override;
+	bool handleMessage(QDBusMessage const &message, QDBusConnection const &connection) override;
+
+signals:
+	// A SetValue from a client, e.g. the platform writing a setting.
+	void valueWritten(QString const &path, QVariant const &value);
+
+protected:
+	// Handles methods of other interfaces, e.g. AddSettings of the fake localsettings.
+	virtual bool handleOther(QDBusMessage const &message, QDBusConnection const &connection);
+
+	QDBusConnection mConnection;
+	QMap<QString, QVariant> mValues; // by path, e.g. /Alarms/LowVoltage
+
+private:
+	QVariantMap subtree(QString const &path, bool text) const;
+	void changed(QString const &path);
+
+	QString mName;
+	bool mRegistered = false;
+};
+
+// Enough of com.victronenergy.settings for the platform to start: its settings are
+// added with the default value and can be written.
+class FakeSettings : public BusService
+{
+	Q_OBJECT
+
+public:
+	FakeSettings(QString const &address, QObject *parent = nullptr);
+
+protected:
+	bool handleOther(QDBusMessage const &message, QDBusConnection const &connection) override;
+};
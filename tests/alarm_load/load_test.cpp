@@ -0,0 +1,570 @@
+#include <algorithm>
+
+#include <QDBusMessage>
+#include <QDebug>
+#include <QProcessEnvironment>
+#include <QRandomGenerator>
+
+#include <veutil/qt/venus_types.hpp>
+
+#include "load_test.hpp"
+
+static char const platformService[] = "com.victronenergy.platform";
+static char const busItemInterface[] = "com.victronenergy.BusItem";
+
+// The services which are created, the type and alarms follow from the name like in
+// the platform itself. Names the platform doesn't know, or without alarms, are skipped.
+static char const *const servicePrefixes[] = {
+	"com.victronenergy.acsystem",
+	"com.victronenergy.alternator",
+	"com.victronenergy.battery",
+	"com.victronenergy.charger",
+	"com.victronenergy.dcdc",
+	"com.victronenergy.dcgenset",
+	"com.victronenergy.dcload",
+	"com.victronenergy.dcsource",
+	"com.victronenergy.dcsystem",
+	"com.victronenergy.digitalinput",
+	"com.victronenergy.fuelcell",
+	"com.victronenergy.generator",
+	"com.victronenergy.genset",
+	"com.victronenergy.hub4",
+	"com.victronenergy.inverter",
+	"com.victronenergy.multi",
+	"com.victronenergy.solarcharger",
+	"com.victronenergy.tank",
+	"com.victronenergy.temperature",
+	"com.victronenergy.vebus",
+	"com.victronenergy.vecan",
+};
+
+// The trigger values raising an alarm per AlarmMonitor::Type, and the ones clearing it.
+static QVariant alarmValue(int type)
+{
+	switch (type) {
+	case AlarmMonitor::REGULAR:
+		return 2;
+	case AlarmMonitor::ALTERNATOR_ERROR:
+	case AlarmMonitor::GENSET_ERROR:
+		return QString("loadtest:e-1");
+	default:
+		return 1;
+	}
+}
+
+static QVariant restValue(int type)
+{
+	if (type == AlarmMonitor::ALTERNATOR_ERROR || type == AlarmMonitor::GENSET_ERROR)
+		return QString("");
+	return 0;
+}
+
+static qint64 percentile(QVector<qint64> const &sorted, int percent)
+{
+	if (sorted.isEmpty())
+		return 0;
+	int n = static_cast<int>((sorted.size() - 1) * percent / 100);
+	return sorted[n];
+}
+
+LoadTest::LoadTest(Options const &options, QObject *parent) :
+	QObject(parent),
+	mOptions(options),
+	mConnection(QString())
+{
+	mPollTimer.setInterval(1000);
+	connect(&mPollTimer, SIGNAL(timeout()), SLOT(onPoll()));
+	mBackgroundTimer.setInterval(qMax(1, 1000 / qMax(1, mOptions.rate)));
+	connect(&mBackgroundTimer, SIGNAL(timeout()), SLOT(onBackgroundTick()));
+	mSampleTimer.setSingleShot(true);
+	mSampleTimer.setInterval(5000);
+	connect(&mSampleTimer, SIGNAL(timeout()), SLOT(onSampleTimeout()));
+	mChurnTimer.setInterval(10);
+	connect(&mChurnTimer, SIGNAL(timeout()), SLOT(onChurnTick()));
+}
+
+LoadTest::~LoadTest()
+{
+	if (mPhase != DONE)
+		finish(1);
+}
+
+void LoadTest::start()
+{
+	BusService::registerTypes();
+
+	if (!startBus()) {
+		finish(1);
+		return;
+	}
+
+	mConnection = QDBusConnection::connectToBus(mAddress, "alarm_load");
+	mConnection.connect(platformService, "/Notifications/Alarm", busItemInterface, "PropertiesChanged",
+						this, SLOT(onAlarmChanged(QVariantMap)));
+	mConnection.connect(platformService, "/", busItemInterface, "ItemsChanged",
+						this, SLOT(onItemsChanged(BusItemMap)));
+
+	// Every trigger change should raise its own notification.
+	mSettings = new FakeSettings(mAddress, this);
+	mSettings->set("/Settings/Alarm/Audible", 0);
+	mSettings->set("/Settings/Alarm/Debounce", 0);
+	mSettings->set("/Settings/Alarm/FlapWindow", 0);
+	// Reclaim services offline for more than a second while churning.
+	if (mOptions.churn > 0)
+		mSettings->set("/Settings/Alarm/ServiceGracePeriod", 1);
+	mSettings->registerService();
+
+	createServices();
+	qInfo() << "[LoadTest]" << mServices.size() << "services with" << mTriggers.size() << "triggers";
+
+	if (!startPlatform()) {
+		finish(1);
+		return;
+	}
+
+	mElapsed.start();
+	mPollTimer.start();
+}
+
+bool LoadTest::startBus()
+{
+	mBus.start("dbus-daemon", QStringList() << "--session" << "--nofork" << "--print-address=1");
+	if (!mBus.waitForStarted() || !mBus.waitForReadyRead(5000)) {
+		qCritical() << "[LoadTest] unable to start dbus-daemon";
+		return false;
+	}
+
+	mAddress = QString::fromLocal8Bit(mBus.readLine()).trimmed();
+	qInfo() << "[LoadTest] private bus at" << mAddress;
+	return !mAddress.isEmpty();
+}
+
+void LoadTest::createServices()
+{
+	for (char const *prefix: servicePrefixes) {
+		VenusServiceType type = venusServiceType(QString(prefix) + ".loadtest");
+		QList<AlarmTable const *> tables;
+
+		switch (type) {
+		case VenusServiceType::BATTERY:
+			tables << &AlarmTables::battery;
+			break;
+		case VenusServiceType::MULTI:
+			tables << &AlarmTables::vebus;
+			break;
+		case VenusServiceType::GENSET:
+		case VenusServiceType::DCGENSET:
+			tables << &AlarmTables::genset;
+			break;
+		default:
+			if (AlarmTable const *table = AlarmTables::forService(type))
+				tables << table;
+			break;
+		}
+
+		if (tables.isEmpty()) {
+			qInfo() << "[LoadTest] skipping" << prefix << "no alarms";
+			continue;
+		}
+
+		for (int n = 0; n < mOptions.servicesPerType; n++)
+			addService(QString(prefix) + ".loadtest_" + QString::number(n), tables, n);
+	}
+}
+
+void LoadTest::addService(QString const &name, QList<AlarmTable const *> const &tables, int instance)
+{
+	BusService *service = new BusService(mAddress, name, this);
+
+	service->set("/ProductName", "Load test");
+	service->set("/CustomName", "");
+	service->set("/DeviceInstance", instance);
+	service->set("/FluidType", 0);
+	service->set("/Mgmt/Connection", "VE.Bus");
+	service->set("/Ac/NumberOfPhases", 1);
+	service->set("/NrOfPhases", 1);
+	service->set("/NrOfDistributors", 0);
+
+	for (AlarmTable const *table: tables) {
+		for (int n = 0; n < table->count; n++) {
+			AlarmDefinition const &definition = table->alarms[n];
+			Trigger trigger = { service, definition.path, definition.type };
+
+			if (definition.valuePath)
+				service->set(definition.valuePath, 0);
+			service->set(trigger.path, restValue(trigger.type));
+
+			if (trigger.type == AlarmMonitor::REGULAR)
+				mRegular.append(mTriggers.size());
+			mTriggers.append(trigger);
+		}
+	}
+
+	service->registerService();
+	mServices.append(service);
+}
+
+bool LoadTest::startPlatform()
+{
+	QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+	env.insert("DBUS_SYSTEM_BUS_ADDRESS", mAddress);
+
+	mPlatform.setProcessEnvironment(env);
+	mPlatform.setProcessChannelMode(QProcess::MergedChannels);
+	mPlatform.setStandardOutputFile(mOptions.log);
+	connect(&mPlatform, SIGNAL(finished(int)), SLOT(onPlatformFinished(int)));
+	mPlatform.start(mOptions.platform, QStringList());
+	if (!mPlatform.waitForStarted()) {
+		qCritical() << "[LoadTest] unable to start" << mOptions.platform;
+		return false;
+	}
+
+	qInfo() << "[LoadTest] started" << mOptions.platform << "output in" << mOptions.log;
+	return true;
+}
+
+QVariant LoadTest::platformValue(QString const &path)
+{
+	QDBusMessage msg = QDBusMessage::createMethodCall(platformService, path, busItemInterface, "GetValue");
+	QDBusMessage reply = mConnection.call(msg, QDBus::Block, 2000);
+
+	if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().isEmpty())
+		return QVariant();
+
+	QVariant value = reply.arguments().first();
+	if (value.userType() == qMetaTypeId<QDBusVariant>())
+		value = value.value<QDBusVariant>().variant();
+	return value;
+}
+
+void LoadTest::platformWrite(QString const &path, QVariant const &value)
+{
+	QDBusMessage msg = QDBusMessage::createMethodCall(platformService, path, busItemInterface, "SetValue");
+	msg << QVariant::fromValue(QDBusVariant(value));
+	mConnection.asyncCall(msg);
+}
+
+void LoadTest::setTrigger(Trigger const &trigger, bool alarm)
+{
+	trigger.service->set(trigger.path, alarm ? alarmValue(trigger.type) : restValue(trigger.type));
+	mWrites++;
+}
+
+void LoadTest::onPoll()
+{
+	switch (mPhase) {
+	case WAIT_ARMED:
+	{
+		// Debug/Alarms is published every 5 seconds.
+		int armed = platformValue("/Debug/Alarms/Armed").toInt();
+		if (armed >= mTriggers.size()) {
+			qInfo() << "[LoadTest]" << armed << "alarms armed after" << mElapsed.elapsed() << "ms";
+			mRssBefore = platformValue("/Debug/Process/Rss").toLongLong();
+			mHeapBefore = platformValue("/Debug/Process/HeapInUse").toLongLong();
+
+			if (mOptions.churn > 0) {
+				mPhase = CHURN;
+				mPollTimer.stop();
+				mChurnTimer.start();
+				break;
+			}
+
+			// Raise every alarm at once and clear them again.
+			mPhase = BURST;
+			mElapsed.restart();
+			for (Trigger const &trigger: mTriggers)
+				setTrigger(trigger, true);
+		} else if (mElapsed.elapsed() > 180000) {
+			qCritical() << "[LoadTest] only" << armed << "of" << mTriggers.size() << "alarms armed";
+			finish(1);
+		}
+		break;
+	}
+	case BURST:
+		if (mElapsed.elapsed() < 5000)
+			break;
+
+		qInfo() << "[LoadTest]" << platformValue("/Notifications/NumberOfNotifications").toInt()
+				<< "notifications after the burst";
+		for (Trigger const &trigger: mTriggers)
+			setTrigger(trigger, false);
+		acknowledge();
+
+		// Samples one alarm at a time, with warnings toggling in the background.
+		mPhase = LATENCY;
+		mPollTimer.stop();
+		mBackgroundTimer.start();
+		QTimer::singleShot(2000, this, [this]() { nextSample(); });
+		break;
+	case SETTLE:
+		settled();
+		break;
+	default:
+		break;
+	}
+}
+
+// Warnings on random services, they don't change /Notifications/Alarm.
+void LoadTest::onBackgroundTick()
+{
+	if (mRegular.isEmpty())
+		return;
+
+	int index = mRegular[QRandomGenerator::global()->bounded(mRegular.size())];
+	if (index == mCurrent)
+		return;
+
+	Trigger const &trigger = mTriggers[index];
+	trigger.service->set(trigger.path, trigger.service->value(trigger.path).toInt() == 0 ? 1 : 0);
+	mWrites++;
+}
+
+void LoadTest::nextSample()
+{
+	if (mPhase != LATENCY)
+		return;
+
+	if (mSample >= mOptions.samples) {
+		mPhase = DONE;
+		mBackgroundTimer.stop();
+		// wait for Debug/Process to be published again
+		QTimer::singleShot(6000, this, [this]() { report(); });
+		return;
+	}
+
+	if (mAlarm) {
+		acknowledge();
+		return;
+	}
+
+	mCurrent = mRegular[QRandomGenerator::global()->bounded(mRegular.size())];
+	// The background might have left it at warning level, start from no alarm.
+	setTrigger(mTriggers[mCurrent], false);
+	mWaitingForAlarm = true;
+	mSampleStart.start();
+	setTrigger(mTriggers[mCurrent], true);
+	mSampleTimer.start();
+}
+
+void LoadTest::acknowledge()
+{
+	platformWrite("/Notifications/AcknowledgeAll", 1);
+}
+
+void LoadTest::onAlarmChanged(QVariantMap const &properties)
+{
+	alarmChanged(properties.value("Value").toInt() != 0);
+}
+
+void LoadTest::onItemsChanged(BusItemMap const &items)
+{
+	auto it = items.constFind("/Notifications/Alarm");
+	if (it != items.constEnd())
+		alarmChanged(it.value().value("Value").toInt() != 0);
+}
+
+void LoadTest::alarmChanged(bool alarm)
+{
+	if (alarm == mAlarm)
+		return;
+	mAlarm = alarm;
+
+	if (mPhase != LATENCY)
+		return;
+
+	if (alarm && mWaitingForAlarm) {
+		mLatencies.append(mSampleStart.nsecsElapsed() / 1000);
+		mWaitingForAlarm = false;
+		mSampleTimer.stop();
+		mSample++;
+		setTrigger(mTriggers[mCurrent], false);
+		mCurrent = -1;
+		acknowledge();
+	} else if (!alarm && !mWaitingForAlarm) {
+		nextSample();
+	}
+}
+
+void LoadTest::onSampleTimeout()
+{
+	qWarning() << "[LoadTest] no alarm for" << mTriggers[mCurrent].service->name() << mTriggers[mCurrent].path;
+	mLost++;
+	mSample++;
+	mWaitingForAlarm = false;
+	setTrigger(mTriggers[mCurrent], false);
+	mCurrent = -1;
+	if (mAlarm)
+		acknowledge();
+	else
+		nextSample();
+}
+
+void LoadTest::report()
+{
+	QVector<qint64> sorted = mLatencies;
+	std::sort(sorted.begin(), sorted.end());
+
+	qint64 rss = platformValue("/Debug/Process/Rss").toLongLong();
+	qint64 heap = platformValue("/Debug/Process/HeapInUse").toLongLong();
+
+	qInfo() << "[LoadTest] trigger to /Notifications/Alarm, us:"
+			<< "samples" << sorted.size() << "lost" << mLost
+			<< "p50" << percentile(sorted, 50) << "p95" << percentile(sorted, 95)
+			<< "p99" << percentile(sorted, 99) << "max" << (sorted.isEmpty() ? 0 : sorted.last());
+	qInfo() << "[LoadTest] platform TriggerToAlarm, us: p50"
+			<< platformValue("/Debug/Alarms/Latency/TriggerToAlarm/P50").toLongLong()
+			<< "p99" << platformValue("/Debug/Alarms/Latency/TriggerToAlarm/P99").toLongLong();
+	qInfo() << "[LoadTest] trigger writes" << mWrites
+			<< "heap in use, kB:" << mHeapBefore << "->" << heap
+			<< "rss, kB:" << mRssBefore << "->" << rss;
+
+	finish(mLost == 0 && !sorted.isEmpty() ? 0 : 1);
+}
+
+/*
+ * Disconnects a random service every tick, which connects again after up to 2.5 seconds.
+ * With a grace period of a second and the reclaim timer of 10 seconds, some of them are
+ * reclaimed and created again, the others are only disconnected.
+ */
+void LoadTest::onChurnTick()
+{
+	int warmup = qBound(1, mOptions.churn / 10, 1000);
+
+	if (mCycles + mDisconnected >= (mWarmedUp ? mOptions.churn : warmup)) {
+		mChurnTimer.stop();
+		if (mDisconnected == 0)
+			settle();
+		return;
+	}
+
+	BusService *service = mServices[QRandomGenerator::global()->bounded(mServices.size())];
+	if (!service->isRegistered())
+		return;
+
+	service->unregisterService();
+	mDisconnected++;
+	QTimer::singleShot(QRandomGenerator::global()->bounded(2500), this, [this, service]() { reconnect(service); });
+}
+
+void LoadTest::reconnect(BusService *service)
+{
+	if (mPhase != CHURN)
+		return;
+
+	service->registerService();
+	mDisconnected--;
+	if (++mCycles % 1000 == 0)
+		qInfo() << "[LoadTest]" << mCycles << "cycles," << platformValue("/Debug/Alarms/ServicesReclaimed").toInt() << "services reclaimed";
+	if (!mChurnTimer.isActive() && mDisconnected == 0)
+		settle();
+}
+
+// Waits until all services are back and armed, see settled.
+void LoadTest::settle()
+{
+	mPhase = SETTLE;
+	mSettledSince = -1;
+	mElapsed.restart();
+	mPollTimer.start();
+}
+
+void LoadTest::settled()
+{
+	int armed = platformValue("/Debug/Alarms/Armed").toInt();
+	int services = platformValue("/Debug/Process/VenusServices").toInt();
+
+	if (armed < mTriggers.size() || services < mServices.size()) {
+		mSettledSince = -1;
+		if (mElapsed.elapsed() > 180000) {
+			qCritical() << "[LoadTest] only" << services << "services and" << armed << "alarms armed after churning";
+			finish(1);
+		}
+		return;
+	}
+
+	// Debug is published every 5 seconds, wait for a publish after getting here.
+	if (mSettledSince < 0)
+		mSettledSince = mElapsed.elapsed();
+	if (mElapsed.elapsed() - mSettledSince < 6000)
+		return;
+
+	mPollTimer.stop();
+	Snapshot current = snapshot();
+	if (mWarmedUp) {
+		churnReport(current);
+		return;
+	}
+
+	mBaseline = current;
+	mWarmedUp = true;
+	qInfo() << "[LoadTest] warmed up after" << mCycles << "cycles:" << current.services << "services"
+			<< current.monitors << "alarms" << "heap in use" << current.heap << "kB rss" << current.rss << "kB";
+	mPhase = CHURN;
+	mChurnTimer.start();
+}
+
+LoadTest::Snapshot LoadTest::snapshot()
+{
+	Snapshot ret;
+	ret.services = platformValue("/Debug/Process/VenusServices").toInt();
+	ret.monitors = platformValue("/Debug/Alarms/Armed").toInt() + platformValue("/Debug/Alarms/Unarmed").toInt();
+	ret.rss = platformValue("/Debug/Process/Rss").toLongLong();
+	ret.heap = platformValue("/Debug/Process/HeapInUse").toLongLong();
+	return ret;
+}
+
+void LoadTest::churnReport(Snapshot const &after)
+{
+	bool ok = true;
+
+	qInfo() << "[LoadTest]" << mCycles << "cycles," << platformValue("/Debug/Alarms/ServicesReclaimed").toInt()
+			<< "services reclaimed";
+	qInfo() << "[LoadTest] services" << mBaseline.services << "->" << after.services
+			<< "alarms" << mBaseline.monitors << "->" << after.monitors
+			<< "heap in use, kB:" << mBaseline.heap << "->" << after.heap
+			<< "rss, kB:" << mBaseline.rss << "->" << after.rss;
+
+	if (after.services != mBaseline.services || after.monitors != mBaseline.monitors) {
+		qCritical() << "[LoadTest] the number of services or alarms changed";
+		ok = false;
+	}
+	if (after.heap - mBaseline.heap > mOptions.tolerance || after.rss - mBaseline.rss > mOptions.tolerance) {
+		qCritical() << "[LoadTest] the memory grew by more than" << mOptions.tolerance << "kB";
+		ok = false;
+	}
+
+	finish(ok ? 0 : 1);
+}
+
+void LoadTest::onPlatformFinished(int exitCode)
+{
+	qCritical() << "[LoadTest] the platform exited with" << exitCode << "see" << mOptions.log;
+	finish(1);
+}
+
+void LoadTest::finish(int exitCode)
+{
+	mPhase = DONE;
+	mPollTimer.stop();
+	mBackgroundTimer.stop();
+	mSampleTimer.stop();
+
+	mPlatform.disconnect(this);
+	if (mPlatform.state() != QProcess::NotRunning) {
+		mPlatform.terminate();
+		if (!mPlatform.waitForFinished(5000))
+			mPlatform.kill();
+	}
+
+	qDeleteAll(mServices);
+	mServices.clear();
+	delete mSettings;
+	mSettings = nullptr;
+
+	if (mBus.state() != QProcess::NotRunning) {
+		mBus.terminate();
+		mBus.waitForFinished(5000);
+	}
+
+	emit finished(exitCode);
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <QDBusConnection>
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QProcess>
+#include <QTimer>
+#include <QVector>
+
+#include "bus_service.hpp"
+#include "src/alarm_tables.hpp"
+
+/*
+ * Runs venus-platform on a private bus, with a fake localsettings and a number of synthetic
+ * services of every type which has alarms, and drives their alarm triggers. It reports the
+ * latency from a trigger change until /Notifications/Alarm follows, as seen by a client,
+ * and the memory of the platform before and after, as exported in Debug/Process.
+ *
+ * With churn set, the services disconnect and connect again instead, for that many cycles,
+ * some long enough to be reclaimed. Afterwards, with all services back, the number of
+ * services and alarms and the memory must be the same as after a warm-up.
+ */
+class LoadTest : public QObject
+{
+	Q_OBJECT
+
+public:
+	struct Options {
+		QString platform;
+		int servicesPerType = 5;
+		int samples = 200;
+		int rate = 100; // background trigger changes per second
+		QString log = "alarm_load-platform.log";
+		int churn = 0; // disconnect / connect cycles, 0 to measure the alarm latency
+		int tolerance = 1024; // kB the memory may grow during churn
+	};
+
+	LoadTest(Options const &options, QObject *parent = nullptr);
+	~LoadTest();
+
+public slots:
+	void start();
+
+signals:
+	void finished(int exitCode);
+
+private slots:
+	void onAlarmChanged(QVariantMap const &properties);
+	void onItemsChanged(BusItemMap const &items);
+	void onPlatformFinished(int exitCode);
+	void onPoll();
+	void onBackgroundTick();
+	void onSampleTimeout();
+	void onChurnTick();
+
+private:
+	enum Phase {
+		WAIT_ARMED,
+		BURST,
+		LATENCY,
+		CHURN,
+		SETTLE,
+		DONE
+	};
+
+	struct Trigger {
+		BusService *service;
+		QString path;
+		int type; // AlarmMonitor::Type
+	};
+
+	// What the platform reports once all services are back.
+	struct Snapshot {
+		int services;
+		int monitors; // armed and unarmed alarms
+		qint64 rss;
+		qint64 heap;
+	};
+
+	bool startBus();
+	void createServices();
+	void addService(QString const &name, QList<AlarmTable const *> const &tables, int instance);
+	bool startPlatform();
+	QVariant platformValue(QString const &path);
+	void platformWrite(QString const &path, QVariant const &value);
+	void setTrigger(Trigger const &trigger, bool alarm);
+	void alarmChanged(bool alarm);
+	void nextSample();
+	void acknowledge();
+	void report();
+	void reconnect(BusService *service);
+	void settle();
+	void settled();
+	Snapshot snapshot();
+	void churnReport(Snapshot const &after);
+	void finish(int exitCode);
+
+	Options mOptions;
+	Phase mPhase = WAIT_ARMED;
+	QProcess mBus;
+	QProcess mPlatform;
+	QString mAddress;
+	QDBusConnection mConnection;
+	FakeSettings *mSettings = nullptr;
+	QList<BusService *> mServices;
+	QVector<Trigger> mTriggers;
+	QVector<int> mRegular; // indices of the REGULAR triggers in mTriggers
+	QTimer mPollTimer;
+	QTimer mBackgroundTimer;
+	QTimer mSampleTimer;
+	QTimer mChurnTimer;
+	QElapsedTimer mElapsed;
+	QElapsedTimer mSampleStart;
+	int mSample = 0;
+	int mCurrent = -1;
+	int mLost = 0;
+	bool mAlarm = false;
+	bool mWaitingForAlarm = false;
+	quint64 mWrites = 0;
+	QVector<qint64> mLatencies; // us
+	qint64 mRssBefore = 0;
+	qint64 mHeapBefore = 0;
+	int mCycles = 0;
+	int mDisconnected = 0;
+	qint64 mSettledSince = -1; // ms, mElapsed
+	bool mWarmedUp = false;
+	Snapshot mBaseline = {};
+};
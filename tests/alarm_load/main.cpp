@@ -0,0 +1,41 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTimer>
+
+#include "load_test.hpp"
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QCommandLineParser parser;
+	LoadTest::Options options;
+
+	parser.setApplicationDescription("Alarm load test of venus-platform on a private bus");
+	parser.addHelpOption();
+	parser.addPositionalArgument("platform", "The venus-platform binary to test");
+	QCommandLineOption services("services", "Services per service type", "count", QString::number(options.servicesPerType));
+	QCommandLineOption samples("samples", "Number of latency samples", "count", QString::number(options.samples));
+	QCommandLineOption rate("rate", "Background trigger changes per second", "rate", QString::number(options.rate));
+	QCommandLineOption log("log", "Output of the platform", "file", options.log);
+	QCommandLineOption churn("churn", "Disconnect / connect cycles instead of measuring the latency", "cycles", QString::number(options.churn));
+	QCommandLineOption tolerance("tolerance", "The memory growth allowed during churn", "kB", QString::number(options.tolerance));
+	parser.addOptions({services, samples, rate, log, churn, tolerance});
+	parser.process(app);
+
+	if (parser.positionalArguments().size() != 1)
+		parser.showHelp(1);
+
+	options.platform = parser.positionalArguments().first();
+	options.servicesPerType = parser.value(services).toInt();
+	options.samples = parser.value(samples).toInt();
+	options.rate = parser.value(rate).toInt();
+	options.log = parser.value(log);
+	options.churn = parser.value(churn).toInt();
+	options.tolerance = parser.value(tolerance).toInt();
+
+	LoadTest test(options);
+	QObject::connect(&test, &LoadTest::finished, &app, &QCoreApplication::exit, Qt::QueuedConnection);
+	QTimer::singleShot(0, &test, SLOT(start()));
+
+	return app.exec();
+}
@@ -17,35 +17,62 @@ INSTALLS += translations
 equals(QT_MAJOR_VERSION, 6): QMAKE_CXXFLAGS += -std=c++17
 
 HEADERS = \
+	src/address_monitor.hpp \
 	src/alarm_item.hpp \
 	src/alarm_monitor.hpp \
+	src/alarm_stats.hpp \
+	src/alarm_tables.hpp \
 	src/application.hpp \
 	src/buzzer.hpp \
 	src/display_controller.hpp \
+	src/firewall_manager.hpp \
+	src/item_id.hpp \
+	src/latency_histogram.hpp \
 	src/led_controller.hpp \
+	src/machine_features.hpp \
 	src/network_controller.h \
 	src/notification.hpp \
+	src/notification_journal.hpp \
 	src/notifications.hpp \
+	src/process_executor.hpp \
+	src/publish_batch.hpp \
 	src/relay.hpp \
 	src/security_profiles.hpp \
+	src/service_templates.hpp \
+	src/startup.hpp \
+	src/startup_timeline.hpp \
+	src/supervise_control.hpp \
 	src/time.hpp \
 	src/updater.hpp \
 	src/venus_service.hpp \
 	src/venus_services.hpp \
 
 SOURCES = \
+	src/address_monitor.cpp \
 	src/alarm_item.cpp \
 	src/alarm_monitor.cpp \
+	src/alarm_stats.cpp \
+	src/alarm_tables.cpp \
 	src/application.cpp \
 	src/buzzer.cpp \
 	src/display_controller.cpp \
+	src/firewall_manager.cpp \
+	src/latency_histogram.cpp \
 	src/led_controller.cpp \
+	src/machine_features.cpp \
 	src/main.cpp \
 	src/network_controller.cpp \
 	src/notification.cpp \
+	src/notification_journal.cpp \
 	src/notifications.cpp \
+	src/process_executor.cpp \
+	src/publish_batch.cpp \
 	src/relay.cpp \
 	src/security_profiles.cpp \
+	src/service_templates.cpp \
+	src/startup.cpp \
+	src/startup_timeline.cpp \
+	src/supervise_control.cpp \
 	src/time.cpp \
 	src/updater.cpp \
 	src/venus_service.cpp \